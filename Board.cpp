@@ -1,5 +1,9 @@
 #include "Board.hpp"
 
+#ifdef BOARD_DEBUG_HASH
+#include <cassert>
+#endif
+
 /*
  Function: BoardInit
  Parameters:
@@ -10,7 +14,8 @@
  */
 void BoardInit(Board* board)
 {
-    memset(board, 0, sizeof(Board));
+    // History is only read below Ply, so it is left uninitialised
+    memset(board, 0, offsetof(Board, History));
     
     board->White.Pawns   = RANK_2;
     board->White.Rooks   = a1 | h1;
@@ -27,6 +32,9 @@ void BoardInit(Board* board)
     board->Black.Queen   = d8;
     board->Black.King    = e8;
     board->Black.Color   = BLACK_PIECE;
+    
+    board->FullmoveNumber = 1;
+    BoardRefresh(board);
 }
 
 /*
@@ -40,752 +48,1930 @@ void BoardInit(Board* board)
  */
 void BoardZeroInit(Board* board)
 {
-    memset(board, 0, sizeof(Board));
+    // History is only read below Ply, so it is left uninitialised
+    memset(board, 0, offsetof(Board, History));
     
     board->White.Color   = WHITE_PIECE;
     board->White.State.Castle  = (KING_HAS_MOVED | KING_ROOK_HAS_MOVED | QUEEN_ROOK_HAS_MOVED);
     
     board->Black.Color   = BLACK_PIECE;
     board->Black.State.Castle  = (KING_HAS_MOVED | KING_ROOK_HAS_MOVED | QUEEN_ROOK_HAS_MOVED);
+    
+    board->FullmoveNumber = 1;
+    BoardRefresh(board);
 }
 
 
-/*
- Function: BoardZeroInit
- Parameters:
-    - Board* Board
-    - Pieces* A
-    - Pieces* B
- Return:
- Notes:
-    This function sets up the board given both side's pieces
- */
-void BoardInitWithPieces(Board* Board, Pieces* A, Pieces* B)
-{
-    if (A->Color == WHITE_PIECE)
-    {
-        memcpy(&Board->White, A, sizeof(Pieces));
-        memcpy(&Board->Black, B, sizeof(Pieces));
-    }
-    else
-    {
-        memcpy(&Board->Black, A, sizeof(Pieces));
-        memcpy(&Board->White, B, sizeof(Pieces));
-    }
-}
+// Centipawns per PieceType. The king is only given a value so that
+// exchanges which would leave it capturable are never worth playing.
+const Int32 BoardPieceValues[PIECE_MAX] = {0, 100, 320, 330, 500, 900, 20000};
 
 /*
- Function: BoardCheckMoveIsLegalByPieceEx
+ Function: BoardPiecesOfTypeEx
  Parameters:
-    - Pieces* A. The moving side
-    - Pieces* B. The non-moving side
-    - PieceType PieceType. The kind of piece being moved
-    - Move Move. Contains the start and end squares for the moving piece
+    - Pieces* A. The side we're looking at.
+    - PieceType PieceType. The kind of piece
  Return:
-    True if the move was successful, false otherwise.
+    UInt64. The squares of A's pieces of PieceType.
  Notes:
-    This function checks if the move is legal.
  */
-bool BoardCheckMoveIsLegalByPieceEx(Pieces* A, Pieces* B, PieceType PieceType, Move Move)
+inline UInt64 BoardPiecesOfTypeEx(Pieces* A, PieceType PieceType)
 {
-    bool   isMoveLegal;
-    Pieces tmpPieces;
-    
-    isMoveLegal = false;
-    memcpy(&tmpPieces, A, sizeof(Pieces));
-    
     switch (PieceType) {
         case PAWN:
-            tmpPieces.Reserved2 = tmpPieces.Pawns;
-            tmpPieces.Pawns &= Move.StartSquare;
-            isMoveLegal = (PiecesPawnMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->Pawns;
         case KNIGHT:
-            tmpPieces.Reserved2 = tmpPieces.Knights;
-            tmpPieces.Knights &= Move.StartSquare;
-            isMoveLegal = (PiecesKnightMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->Knights;
         case BISHOP:
-            tmpPieces.Reserved2 = tmpPieces.Bishops;
-            tmpPieces.Bishops &= Move.StartSquare;
-            isMoveLegal = (PiecesBishopMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->Bishops;
         case ROOK:
-            tmpPieces.Reserved2 = tmpPieces.Rooks;
-            tmpPieces.Rooks &= Move.StartSquare;
-            isMoveLegal = (PiecesRookMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->Rooks;
         case QUEEN:
-            tmpPieces.Reserved2 = tmpPieces.Queen;
-            tmpPieces.Queen &= Move.StartSquare;
-            isMoveLegal = (PiecesQueenMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->Queen;
         case KING:
-            tmpPieces.King &= Move.StartSquare;
-            isMoveLegal = (PiecesKingMove(&tmpPieces, B) & Move.EndSquare);
-            break;
+            return A->King;
         default:
             break;
     }
     
-    return isMoveLegal;
+    return 0;
+}
+
+/*
+ Zobrist keys. Every piece on every square, each side's castle
+ flags, the en passant file and black to move get a random key, and
+ Board->Hash is the XOR of the keys that apply to the position.
+ */
+struct ZobristKeys {
+    UInt64 Pieces[2][PIECE_MAX][64];
+    UInt64 Castle[2][8];
+    UInt64 EnPassant[8];
+    UInt64 Side;
+};
+
+/*
+ Function: BoardSplitMixEx
+ Parameters:
+    - UInt64* State. The generator state, advanced on each call
+ Return:
+    UInt64. The next SplitMix64 output.
+ Notes:
+ */
+constexpr UInt64 BoardSplitMixEx(UInt64* State)
+{
+    UInt64 z = (*State += 0x9E3779B97F4A7C15ULL);
+    
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    
+    return z ^ (z >> 31);
 }
 
 /*
- Function: BoardPromotePawnEx
+ Function: BoardZobristKeysEx
  Parameters:
-    - Pieces* A. Promote side
-    - Move Move. Move object info about the pawn
  Return:
+    ZobristKeys. Pseudo-random keys from a fixed seed.
  Notes:
-    This function gets the promotion choice via
-    stdin. Open-source users should modify their
-    input choice here.
+    Evaluated at compile time, so hashes are the same on every run.
  */
-void BoardPromotePawnEx(Pieces* A, Move Move)
+constexpr ZobristKeys BoardZobristKeysEx()
 {
-    string userInput;
-    bool   userInputIsValid = false;
+    ZobristKeys keys = {};
+    UInt64 state = 0x1070372ULL;
     
-    while (userInputIsValid == false)
+    for (UInt64 color = 0; color < 2; color++)
     {
-        cout << "Pawn promotion" << endl;
-        cout << "Queen (Q), Rook (R), Bishop (B), Knight (N): ";
-        getline(cin, userInput);
-        userInputIsValid = true;
-        
-        if (userInput == "Q")
+        for (UInt64 pieceType = 0; pieceType < PIECE_MAX; pieceType++)
         {
-            A->Queen |= Move.EndSquare;
+            for (UInt64 square = 0; square < 64; square++)
+            {
+                keys.Pieces[color][pieceType][square] = BoardSplitMixEx(&state);
+            }
         }
-        else if (userInput == "R")
+        for (UInt64 castle = 0; castle < 8; castle++)
         {
-            A->Rooks |= Move.EndSquare;
+            keys.Castle[color][castle] = BoardSplitMixEx(&state);
         }
-        else if (userInput == "B")
+    }
+    for (UInt64 file = 0; file < 8; file++)
+    {
+        keys.EnPassant[file] = BoardSplitMixEx(&state);
+    }
+    keys.Side = BoardSplitMixEx(&state);
+    
+    return keys;
+}
+
+constexpr ZobristKeys Zobrist = BoardZobristKeysEx();
+
+/*
+ Function: BoardEnPassantHashEx
+ Parameters:
+    - Board* Board
+ Return:
+    UInt64. The en passant file key of the position, 0 if there is
+    no en passant square or no pawn stands next to it.
+ Notes:
+    A double push that no pawn can take adds nothing to the key, so
+    it transposes with the same position reached another way.
+ */
+UInt64 BoardEnPassantHashEx(Board* Board)
+{
+    Pieces* sides[2] = {&Board->White, &Board->Black};
+    UInt64  enPassantSquare, enPassantIndex;
+    
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
+    {
+        enPassantSquare = sides[color]->State.EnPassant;
+        if (enPassantSquare == 0)
         {
-            A->Bishops |= Move.EndSquare;
+            continue;
         }
-        else if (userInput == "N")
+        
+        enPassantIndex = LeastSigBitIndex(enPassantSquare);
+        if (PiecesPawnAttacks(color, enPassantIndex) & sides[color ^ 1]->Pawns)
         {
-            A->Knights |= Move.EndSquare;
+            return Zobrist.EnPassant[enPassantIndex & 0x7];
         }
-        else
+    }
+    
+    return 0;
+}
+
+/*
+ Function: BoardComputePawnHash
+ Parameters:
+    - Board* Board
+ Return:
+    UInt64. The Zobrist key of the pawns alone, built from scratch.
+ Notes:
+    Positions with the same pawns share a pawn structure score, so
+    this keys the pawn hash table. Board->PawnHash is kept up to date
+    by BoardMakeMove.
+ */
+UInt64 BoardComputePawnHash(Board* Board)
+{
+    Pieces* sides[2] = {&Board->White, &Board->Black};
+    UInt64  hash = 0;
+    UInt64  pieces;
+    
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
+    {
+        pieces = sides[color]->Pawns;
+        while (pieces != 0)
         {
-            cout << "Invalid promotion choice." << endl;
-            userInputIsValid = false;
+            hash ^= Zobrist.Pieces[color][PAWN][PopLeastSigBit(&pieces)];
         }
-        A->Pawns  = Intersect(A->Pawns, Move.EndSquare);
     }
+    
+    return hash;
 }
 
 /*
- Function: BoardCompleteMoveEx
+ Function: BoardComputeHash
  Parameters:
-    - Pieces* A. The moving side
-    - PieceType AType. The kind of piece being moved by A
-    - Pieces* B. The non-moving side
-    - PieceType BType. The kind of piece not being moved by B
-    - Move Move. Contains the start and end squares for A's moving piece
+    - Board* Board
  Return:
+    UInt64. The Zobrist key of the position, built from scratch.
  Notes:
-    This function updates the bit boards and also performs en passant,
-    castling, and promotions when needed.
+    BoardMakeMove keeps Board->Hash up to date incrementally; this is
+    the reference it is checked against.
  */
-void BoardCompleteMoveEx(Pieces* A, PieceType AType, Pieces* B, PieceType BType, Move Move)
+UInt64 BoardComputeHash(Board* Board)
 {
-    bool isEnPassantMove = false;
+    Pieces* sides[2] = {&Board->White, &Board->Black};
+    UInt64  hash = 0;
+    UInt64  pieces;
     
-    switch (AType) {
-        case PAWN:
-            A->Pawns |= Move.EndSquare;
-            A->Pawns  = Intersect(A->Pawns, Move.StartSquare);
-            // Check if move is an en passant move or promotion
-            if (A->Color == WHITE_PIECE)
-            {
-                if (B->State.LastMovedPiece == PAWN &&
-                    (B->State.LastMove.EndSquare & RANK_5) &&
-                    (B->State.LastMove.StartSquare & RANK_7) &&
-                    ((Move.EndSquare >> 8) & B->State.LastMove.EndSquare))
-                {
-                    isEnPassantMove = true;
-                    break;
-                }
-                
-                if (Move.EndSquare & RANK_8)
-                {
-                    BoardPromotePawnEx(A, Move);
-                    break;
-                }
-            }
-            else
-            {
-                if (B->State.LastMovedPiece == PAWN &&
-                    (B->State.LastMove.EndSquare & RANK_4) &&
-                    (B->State.LastMove.StartSquare & RANK_2) &&
-                    ((Move.EndSquare << 8) & B->State.LastMove.EndSquare))
-                {
-                    isEnPassantMove = true;
-                    break;
-                }
-                
-                if (Move.EndSquare & RANK_1)
-                {
-                    BoardPromotePawnEx(A, Move);
-                    break;
-                }
-            }
-            break;
-        case KNIGHT:
-            A->Knights |= Move.EndSquare;
-            A->Knights  = Intersect(A->Knights, Move.StartSquare);
-            break;
-        case BISHOP:
-            A->Bishops |= Move.EndSquare;
-            A->Bishops  = Intersect(A->Bishops, Move.StartSquare);
-            break;
-        case ROOK:
-            A->Rooks |= Move.EndSquare;
-            A->Rooks  = Intersect(A->Rooks, Move.StartSquare);
-            if (A->Color == WHITE_PIECE)
-            {
-                if (Move.StartSquare == a1)
-                {
-                    A->State.Castle |= QUEEN_ROOK_HAS_MOVED;
-                }
-                else if (Move.StartSquare == h1)
-                {
-                    A->State.Castle |= KING_ROOK_HAS_MOVED;
-                }
-            }
-            else
-            {
-                if (Move.StartSquare == a8)
-                {
-                    A->State.Castle |= QUEEN_ROOK_HAS_MOVED;
-                }
-                else if (Move.StartSquare == h8)
-                {
-                    A->State.Castle |= KING_ROOK_HAS_MOVED;
-                }
-            }
-            break;
-        case QUEEN:
-            A->Queen |= Move.EndSquare;
-            A->Queen  = Intersect(A->Queen, Move.StartSquare);
-            break;
-        case KING:
-            A->King |= Move.EndSquare;
-            A->King  = Intersect(A->King, Move.StartSquare);
-            // Castle logic
-            if ((A->State.Castle & KING_HAS_MOVED) == 0x0)
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
+    {
+        for (UInt64 pieceType = PAWN; pieceType <= KING; pieceType++)
+        {
+            pieces = BoardPiecesOfTypeEx(sides[color], (PieceType)pieceType);
+            while (pieces != 0)
             {
-                if (A->Color == WHITE_PIECE)
-                {
-                    if (Move.EndSquare == g1 &&
-                        (A->State.Castle & KING_ROOK_HAS_MOVED) == 0x0)
-                    {
-                        // White king is castling short
-                        A->State.Castle |= KING_ROOK_HAS_MOVED;
-                        A->Rooks  = Intersect(A->Rooks, h1);
-                        A->Rooks |= f1;
-                    }
-                    else if (Move.EndSquare == c1 &&
-                             (A->State.Castle & QUEEN_ROOK_HAS_MOVED) == 0x0)
-                    {
-                        // White king is castling long
-                        A->State.Castle |= QUEEN_ROOK_HAS_MOVED;
-                        A->Rooks  = Intersect(A->Rooks, a1);
-                        A->Rooks |= d1;
-                    }
-                }
-                else
-                {
-                    if (Move.EndSquare == g8 &&
-                        (A->State.Castle & KING_ROOK_HAS_MOVED) == 0x0)
-                    {
-                        // Black king is castling short
-                        A->State.Castle |= KING_ROOK_HAS_MOVED;
-                        A->Rooks  = Intersect(A->Rooks, h8);
-                        A->Rooks |= f8;
-                    }
-                    else if (Move.EndSquare == c8 &&
-                             (A->State.Castle & QUEEN_ROOK_HAS_MOVED) == 0x0)
-                    {
-                        // White king is castling long
-                        A->State.Castle |= QUEEN_ROOK_HAS_MOVED;
-                        A->Rooks  = Intersect(A->Rooks, a8);
-                        A->Rooks |= d8;
-                    }
-                }
+                hash ^= Zobrist.Pieces[color][pieceType][PopLeastSigBit(&pieces)];
             }
-            A->State.Castle |= KING_HAS_MOVED;
-            break;
-        default:
-            break;
+        }
+        hash ^= Zobrist.Castle[color][sides[color]->State.Castle & 0x7];
     }
     
-    switch (BType) {
-        case PAWN:
-            B->Pawns &= ~Move.EndSquare;
-            break;
-        case KNIGHT:
-            B->Knights &= ~Move.EndSquare;
-            break;
-        case BISHOP:
-            B->Bishops &= ~Move.EndSquare;
-            break;
-        case ROOK:
-            B->Rooks &= ~Move.EndSquare;
-            break;
-        case QUEEN:
-            B->Queen &= ~Move.EndSquare;
-            break;
-        case KING:
-            B->King &= ~Move.EndSquare;
-            break;
-        case NONE:
-            // If the last move was an en passant move,
-            // the captured pawn must be removed.
-            if (isEnPassantMove == true)
+    hash ^= BoardEnPassantHashEx(Board);
+    
+    if (Board->SideToMove == BLACK_PIECE)
+    {
+        hash ^= Zobrist.Side;
+    }
+    
+    return hash;
+}
+
+/*
+ Piece-square tables, the PeSTO values. Each is seen from White's
+ side and written rank 8 first, so it reads like a diagram; the
+ piece's material value is added on top by BoardPieceSquaresEx.
+ */
+constexpr Int32 BoardMiddlegameMaterial[PIECE_MAX] = {0, 82, 337, 365, 477, 1025, 0};
+constexpr Int32 BoardEndgameMaterial[PIECE_MAX]    = {0, 94, 281, 297, 512, 936, 0};
+constexpr Int32 BoardPhaseWeights[PIECE_MAX]       = {0, 0, 1, 1, 2, 4, 0};
+
+constexpr Int32 BoardMiddlegameTables[PIECE_MAX][64] = {
+    {0},
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+       98, 134,  61,  95,  68, 126,  34, -11,
+       -6,   7,  26,  31,  65,  56,  25, -20,
+      -14,  13,   6,  21,  23,  12,  17, -23,
+      -27,  -2,  -5,  12,  17,   6,  10, -25,
+      -26,  -4,  -4, -10,   3,   3,  33, -12,
+      -35,  -1, -20, -23, -15,  24,  38, -22,
+        0,   0,   0,   0,   0,   0,   0,   0},
+    {-167, -89, -34, -49,  61, -97, -15,-107,
+      -73, -41,  72,  36,  23,  62,   7, -17,
+      -47,  60,  37,  65,  84, 129,  73,  44,
+       -9,  17,  19,  53,  37,  69,  18,  22,
+      -13,   4,  16,  13,  28,  19,  21,  -8,
+      -23,  -9,  12,  10,  19,  17,  25, -16,
+      -29, -53, -12,  -3,  -1,  18, -14, -19,
+     -105, -21, -58, -33, -17, -28, -19, -23},
+    { -29,   4, -82, -37, -25, -42,   7,  -8,
+      -26,  16, -18, -13,  30,  59,  18, -47,
+      -16,  37,  43,  40,  35,  50,  37,  -2,
+       -4,   5,  19,  50,  37,  37,   7,  -2,
+       -6,  13,  13,  26,  34,  12,  10,   4,
+        0,  15,  15,  15,  14,  27,  18,  10,
+        4,  15,  16,   0,   7,  21,  33,   1,
+      -33,  -3, -14, -21, -13, -12, -39, -21},
+    {  32,  42,  32,  51,  63,   9,  31,  43,
+       27,  32,  58,  62,  80,  67,  26,  44,
+       -5,  19,  26,  36,  17,  45,  61,  16,
+      -24, -11,   7,  26,  24,  35,  -8, -20,
+      -36, -26, -12,  -1,   9,  -7,   6, -23,
+      -45, -25, -16, -17,   3,   0,  -5, -33,
+      -44, -16, -20,  -9,  -1,  11,  -6, -71,
+      -19, -13,   1,  17,  16,   7, -37, -26},
+    { -28,   0,  29,  12,  59,  44,  43,  45,
+      -24, -39,  -5,   1, -16,  57,  28,  54,
+      -13, -17,   7,   8,  29,  56,  47,  57,
+      -27, -27, -16, -16,  -1,  17,  -2,   1,
+       -9, -26,  -9, -10,  -2,  -4,   3,  -3,
+      -14,   2, -11,  -2,  -5,   2,  14,   5,
+      -35,  -8,  11,   2,   8,  15,  -3,   1,
+       -1, -18,  -9,  10, -15, -25, -31, -50},
+    { -65,  23,  16, -15, -56, -34,   2,  13,
+       29,  -1, -20,  -7,  -8,  -4, -38, -29,
+       -9,  24,   2, -16, -20,   6,  22, -22,
+      -17, -20, -12, -27, -30, -25, -14, -36,
+      -49,  -1, -27, -39, -46, -44, -33, -51,
+      -14, -14, -22, -46, -44, -30, -15, -27,
+        1,   7,  -8, -64, -43, -16,   9,   8,
+      -15,  36,  12, -54,   8, -28,  24,  14},
+};
+
+constexpr Int32 BoardEndgameTables[PIECE_MAX][64] = {
+    {0},
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+      178, 173, 158, 134, 147, 132, 165, 187,
+       94, 100,  85,  67,  56,  53,  82,  84,
+       32,  24,  13,   5,  -2,   4,  17,  17,
+       13,   9,  -3,  -7,  -7,  -8,   3,  -1,
+        4,   7,  -6,   1,   0,  -5,  -1,  -8,
+       13,   8,   8,  10,  13,   0,   2,  -7,
+        0,   0,   0,   0,   0,   0,   0,   0},
+    { -58, -38, -13, -28, -31, -27, -63, -99,
+      -25,  -8, -25,  -2,  -9, -25, -24, -52,
+      -24, -20,  10,   9,  -1,  -9, -19, -41,
+      -17,   3,  22,  22,  22,  11,   8, -18,
+      -18,  -6,  16,  25,  16,  17,   4, -18,
+      -23,  -3,  -1,  15,  10,  -3, -20, -22,
+      -42, -20, -10,  -5,  -2, -20, -23, -44,
+      -29, -51, -23, -15, -22, -18, -50, -64},
+    { -14, -21, -11,  -8,  -7,  -9, -17, -24,
+       -8,  -4,   7, -12,  -3, -13,  -4, -14,
+        2,  -8,   0,  -1,  -2,   6,   0,   4,
+       -3,   9,  12,   9,  14,  10,   3,   2,
+       -6,   3,  13,  19,   7,  10,  -3,  -9,
+      -12,  -3,   8,  10,  13,   3,  -7, -15,
+      -14, -18,  -7,  -1,   4,  -9, -15, -27,
+      -23,  -9, -23,  -5,  -9, -16,  -5, -17},
+    {  13,  10,  18,  15,  12,  12,   8,   5,
+       11,  13,  13,  11,  -3,   3,   8,   3,
+        7,   7,   7,   5,   4,  -3,  -5,  -3,
+        4,   3,  13,   1,   2,   1,  -1,   2,
+        3,   5,   8,   4,  -5,  -6,  -8, -11,
+       -4,   0,  -5,  -1,  -7, -12,  -8, -16,
+       -6,  -6,   0,   2,  -9,  -9, -11,  -3,
+       -9,   2,   3,  -1,  -5, -13,   4, -20},
+    {  -9,  22,  22,  27,  27,  19,  10,  20,
+      -17,  20,  32,  41,  58,  25,  30,   0,
+      -20,   6,   9,  49,  47,  35,  19,   9,
+        3,  22,  24,  45,  57,  40,  57,  36,
+      -18,  28,  19,  47,  31,  34,  39,  23,
+      -16, -27,  15,   6,   9,  17,  10,   5,
+      -22, -23, -30, -16, -16, -23, -36, -32,
+      -33, -28, -22, -43,  -5, -32, -20, -41},
+    { -74, -35, -18, -18, -11,  15,   4, -17,
+      -12,  17,  14,  17,  17,  38,  23,  11,
+       10,  17,  23,  15,  20,  45,  44,  13,
+       -8,  22,  24,  27,  26,  33,  26,   3,
+      -18,  -4,  21,  24,  27,  23,   9, -11,
+      -19,  -3,  11,  21,  23,  16,   7,  -9,
+      -27, -11,   4,  13,  14,   4,  -5, -17,
+      -53, -34, -21, -11, -28, -14, -24, -43},
+};
+
+/*
+ What each piece on each square adds to a BoardScore: material plus
+ piece-square bonus, negative for Black's pieces.
+ */
+struct PieceSquareScores {
+    Int32 Middlegame[2][PIECE_MAX][64];
+    Int32 Endgame[2][PIECE_MAX][64];
+};
+
+/*
+ Function: BoardPieceSquaresEx
+ Parameters:
+ Return:
+    PieceSquareScores. The tables above, indexed a1 = 0 for each color.
+ Notes:
+    Evaluated at compile time. A white piece on square i reads the
+    table at i ^ 56, which turns it to rank 8 first; a black piece
+    reads it at i, which is the same square seen from Black's side.
+ */
+constexpr PieceSquareScores BoardPieceSquaresEx()
+{
+    PieceSquareScores scores = {};
+    
+    for (UInt64 pieceType = PAWN; pieceType < PIECE_MAX; pieceType++)
+    {
+        for (UInt64 square = 0; square < 64; square++)
+        {
+            scores.Middlegame[WHITE_PIECE][pieceType][square] =
+                BoardMiddlegameMaterial[pieceType] + BoardMiddlegameTables[pieceType][square ^ 56];
+            scores.Endgame[WHITE_PIECE][pieceType][square] =
+                BoardEndgameMaterial[pieceType] + BoardEndgameTables[pieceType][square ^ 56];
+            scores.Middlegame[BLACK_PIECE][pieceType][square] =
+                -(BoardMiddlegameMaterial[pieceType] + BoardMiddlegameTables[pieceType][square]);
+            scores.Endgame[BLACK_PIECE][pieceType][square] =
+                -(BoardEndgameMaterial[pieceType] + BoardEndgameTables[pieceType][square]);
+        }
+    }
+    
+    return scores;
+}
+
+constexpr PieceSquareScores PieceSquares = BoardPieceSquaresEx();
+
+/*
+ Function: BoardScorePieceEx
+ Parameters:
+    - BoardScore* Score. The score to change
+    - UInt64 Color. The piece's color
+    - PieceType PieceType. The piece, PAWN through KING
+    - UInt64 Index. The square it is put on or taken off
+    - Int32 Sign. 1 to put the piece on, -1 to take it off
+ Return:
+ Notes:
+ */
+inline void BoardScorePieceEx(BoardScore* Score, UInt64 Color, PieceType PieceType, UInt64 Index, Int32 Sign)
+{
+    Score->Middlegame += Sign * PieceSquares.Middlegame[Color][PieceType][Index];
+    Score->Endgame    += Sign * PieceSquares.Endgame[Color][PieceType][Index];
+    Score->Phase      += Sign * BoardPhaseWeights[PieceType];
+}
+
+/*
+ Function: BoardComputeScore
+ Parameters:
+    - Board* Board
+ Return:
+    BoardScore. The material and piece-square score of the position,
+    built from scratch.
+ Notes:
+    BoardMakeMove keeps Board->Score up to date incrementally; this
+    is the reference it is checked against.
+ */
+BoardScore BoardComputeScore(Board* Board)
+{
+    Pieces*    sides[2] = {&Board->White, &Board->Black};
+    BoardScore score = {0, 0, 0};
+    UInt64     pieces;
+    
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
+    {
+        for (UInt64 pieceType = PAWN; pieceType <= KING; pieceType++)
+        {
+            pieces = BoardPiecesOfTypeEx(sides[color], (PieceType)pieceType);
+            while (pieces != 0)
             {
-                if (A->Color == WHITE_PIECE)
-                {
-                    B->Pawns &= ~(Move.EndSquare >> 8);
-                }
-                else
-                {
-                    B->Pawns &= ~(Move.EndSquare << 8);
-                }
+                BoardScorePieceEx(&score, color, (PieceType)pieceType, PopLeastSigBit(&pieces), 1);
             }
-            break;
-        default:
-            break;
+        }
     }
+    
+    return score;
 }
 
 /*
- Function: BoardAttemptMove
+ Function: BoardRefresh
  Parameters:
-    - Board* Board. The current chess board
-    - Move Move. The move to be attempted
-    - UInt64 Color. The color of the side making the move.
-    - bool ReturnPosition. When true, Board will be updated on exit.
+    - Board* Board
  Return:
-    bool - If the attempted move is legal, this function returns true,
-           false otherwise.
  Notes:
-    If ReturnPosition is true, the board object passed in will be updated
-    with the legal move on exit.
+    Rebuilds Board->Mailbox, the occupancy bit boards, the hashes and
+    the score from the piece bit boards. Make and unmake keep them in sync on
+    their own; call this after setting the bit boards by hand.
  */
-bool BoardAttemptMove(Board* Board, Move Move, UInt64 Color, bool ReturnPosition = false)
+void BoardRefresh(Board* Board)
 {
-    bool      isMoveLegal;
-    UInt64    attackedSquares;
-    PieceType movingPieceType, nonMovingPieceType;
-    Pieces    movingSide, nonMovingSide;
+    Pieces* sides[2] = {&Board->White, &Board->Black};
+    UInt64  pieces;
     
-    isMoveLegal = true;
+    memset(Board->Mailbox, NONE, sizeof(Board->Mailbox));
     
-    if (Color == WHITE_PIECE)
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
     {
-        memcpy(&movingSide, &Board->White, sizeof(Pieces));
-        memcpy(&nonMovingSide, &Board->Black, sizeof(Pieces));
+        for (UInt64 pieceType = PAWN; pieceType <= KING; pieceType++)
+        {
+            pieces = BoardPiecesOfTypeEx(sides[color], (PieceType)pieceType);
+            while (pieces != 0)
+            {
+                Board->Mailbox[PopLeastSigBit(&pieces)] = MailboxPiece(pieceType, color);
+            }
+        }
+        PiecesRefreshOccupancy(sides[color]);
     }
-    else if (Color == BLACK_PIECE)
+    
+    Board->Occupancy = Board->White.Occupancy | Board->Black.Occupancy;
+    Board->Hash      = BoardComputeHash(Board);
+    Board->PawnHash  = BoardComputePawnHash(Board);
+    Board->Score     = BoardComputeScore(Board);
+}
+
+/*
+ Function: BoardInitWithPieces
+ Parameters:
+    - Board* Board
+    - Pieces* A
+    - Pieces* B
+ Return:
+ Notes:
+    This function sets up the board given both side's pieces
+ */
+void BoardInitWithPieces(Board* Board, Pieces* A, Pieces* B)
+{
+    Board->Ply            = 0;
+    Board->SideToMove     = B->Color;
+    Board->HalfmoveClock  = 0;
+    Board->FullmoveNumber = 1;
+    
+    if (A->Color == WHITE_PIECE)
     {
-        memcpy(&movingSide, &Board->Black, sizeof(Pieces));
-        memcpy(&nonMovingSide, &Board->White, sizeof(Pieces));
+        memcpy(&Board->White, A, sizeof(Pieces));
+        memcpy(&Board->Black, B, sizeof(Pieces));
     }
     else
     {
-        // Unknown color
-        isMoveLegal = false;
-        goto End;
+        memcpy(&Board->Black, A, sizeof(Pieces));
+        memcpy(&Board->White, B, sizeof(Pieces));
     }
     
+    BoardRefresh(Board);
+}
 
-    movingPieceType = PiecesMapSquareToPiece(&movingSide, Move.StartSquare);
-    if (movingPieceType == NONE)
+/*
+ Function: BoardPromotionChoiceEx
+ Parameters:
+ Return:
+    PieceType. The piece the player promotes to.
+ Notes:
+    This function gets the promotion choice via stdin.
+    Open-source users should modify their input choice here.
+ */
+PieceType BoardPromotionChoiceEx()
+{
+    string    userInput;
+    PieceType promotion = NONE;
+    
+    while (promotion == NONE)
     {
-        // Trying to move a piece on a square that color does not have.
-        isMoveLegal = false;
+        cout << "Pawn promotion" << endl;
+        cout << "Queen (Q), Rook (R), Bishop (B), Knight (N): ";
+        getline(cin, userInput);
+        
+        if (userInput == "Q")
+        {
+            promotion = QUEEN;
+        }
+        else if (userInput == "R")
+        {
+            promotion = ROOK;
+        }
+        else if (userInput == "B")
+        {
+            promotion = BISHOP;
+        }
+        else if (userInput == "N")
+        {
+            promotion = KNIGHT;
+        }
+        else
+        {
+            cout << "Invalid promotion choice." << endl;
+        }
+    }
+    
+    return promotion;
+}
+
+/*
+ Function: BoardPieceSetEx
+ Parameters:
+    - Pieces* A. The side we're looking at.
+    - PieceType PieceType. The kind of piece, PAWN through KING
+ Return:
+    UInt64*. The bit board holding A's pieces of PieceType.
+ Notes:
+ */
+inline UInt64* BoardPieceSetEx(Pieces* A, PieceType PieceType)
+{
+    switch (PieceType) {
+        case PAWN:
+            return &A->Pawns;
+        case KNIGHT:
+            return &A->Knights;
+        case BISHOP:
+            return &A->Bishops;
+        case ROOK:
+            return &A->Rooks;
+        case QUEEN:
+            return &A->Queen;
+        default:
+            break;
+    }
+    
+    return &A->King;
+}
+
+/*
+ Function: BoardRookCastleFlagEx
+ Parameters:
+    - Pieces* A. The side owning the rook
+    - UInt64 Square. A square a rook moved from or was captured on
+ Return:
+    UInt8. The castle flag lost when that square's rook is gone,
+    0 if Square is not one of A's rook corners.
+ Notes:
+ */
+inline UInt8 BoardRookCastleFlagEx(Pieces* A, UInt64 Square)
+{
+    if (Square == ((A->Color == WHITE_PIECE) ? h1 : h8))
+    {
+        return KING_ROOK_HAS_MOVED;
+    }
+    if (Square == ((A->Color == WHITE_PIECE) ? a1 : a8))
+    {
+        return QUEEN_ROOK_HAS_MOVED;
+    }
+    
+    return 0;
+}
+
+/*
+ Function: BoardFromFEN
+ Parameters:
+    - Board* Board. Set up from FEN on success
+    - const char* FEN. A position in Forsyth-Edwards Notation
+ Return:
+    bool - True if FEN was parsed, false if it is malformed or the
+           position could not occur in a game.
+ Notes:
+    Each side must have exactly one king, no pawn may stand on the
+    first or last rank, and the side not to move must not be in check.
+    Castle availability maps onto PlayingState.Castle, and the en
+    passant square onto PlayingState.EnPassant of the side that just
+    moved. The halfmove and fullmove counters may be left off, and
+    then start at 0 and 1. Nothing is allocated.
+ */
+bool BoardFromFEN(Board* Board, const char* FEN)
+{
+    const char* symbols = ".PNBRQK..pnbrqk";
+    const char* c = FEN;
+    const char* symbol;
+    Pieces*     side;
+    Int64       rank = 7, file = 0;
+    UInt64      index;
+    UInt8       entry;
+    bool        isParsed = false;
+    
+    memset(Board, 0, offsetof(struct Board, History));
+    Board->FullmoveNumber = 1;
+    Board->White.Color = WHITE_PIECE;
+    Board->Black.Color = BLACK_PIECE;
+    Board->White.State.Castle = KING_ROOK_HAS_MOVED | QUEEN_ROOK_HAS_MOVED;
+    Board->Black.State.Castle = KING_ROOK_HAS_MOVED | QUEEN_ROOK_HAS_MOVED;
+    
+    // Piece placement, from a8 towards h1
+    for (; *c != ' ' && *c != '\0'; c++)
+    {
+        if (*c == '/')
+        {
+            if (file != 8 || rank == 0)
+            {
+                goto End;
+            }
+            rank--;
+            file = 0;
+        }
+        else if (*c >= '1' && *c <= '8')
+        {
+            file += *c - '0';
+            if (file > 8)
+            {
+                goto End;
+            }
+        }
+        else
+        {
+            symbol = strchr(symbols, *c);
+            if (symbol == NULL || *c == '.' || file > 7)
+            {
+                goto End;
+            }
+            entry = (UInt8)(symbol - symbols);
+            side  = (MailboxColor(entry) == WHITE_PIECE) ? &Board->White : &Board->Black;
+            *BoardPieceSetEx(side, MailboxType(entry)) |= 0x1ULL << (rank * 8 + file);
+            file++;
+        }
+    }
+    if (rank != 0 || file != 8 || *c++ != ' ')
+    {
+        goto End;
+    }
+    
+    // One king a side, and no pawn where a pawn can never stand
+    if (BitCount(Board->White.King) != 1 || BitCount(Board->Black.King) != 1 ||
+        ((Board->White.Pawns | Board->Black.Pawns) & (RANK_1 | RANK_8)) != 0)
+    {
+        goto End;
+    }
+    
+    // Side to move
+    if ((*c != 'w' && *c != 'b') || c[1] != ' ')
+    {
+        goto End;
+    }
+    Board->SideToMove = (*c == 'w') ? WHITE_PIECE : BLACK_PIECE;
+    c += 2;
+    
+    // Castle availability
+    for (; *c != ' ' && *c != '\0'; c++)
+    {
+        switch (*c) {
+            case 'K':
+                Board->White.State.Castle &= ~KING_ROOK_HAS_MOVED;
+                break;
+            case 'Q':
+                Board->White.State.Castle &= ~QUEEN_ROOK_HAS_MOVED;
+                break;
+            case 'k':
+                Board->Black.State.Castle &= ~KING_ROOK_HAS_MOVED;
+                break;
+            case 'q':
+                Board->Black.State.Castle &= ~QUEEN_ROOK_HAS_MOVED;
+                break;
+            case '-':
+                break;
+            default:
+                goto End;
+        }
+    }
+    for (UInt64 color = WHITE_PIECE; color <= BLACK_PIECE; color++)
+    {
+        side = (color == WHITE_PIECE) ? &Board->White : &Board->Black;
+        if (side->State.Castle == (KING_ROOK_HAS_MOVED | QUEEN_ROOK_HAS_MOVED))
+        {
+            side->State.Castle |= KING_HAS_MOVED;
+        }
+    }
+    if (*c++ != ' ')
+    {
+        goto End;
+    }
+    
+    // En passant square, kept as the double push that made it
+    if (*c == '-')
+    {
+        c++;
+    }
+    else
+    {
+        if (c[0] < 'a' || c[0] > 'h' ||
+            (c[1] != '3' && c[1] != '6') ||
+            (c[1] == '3') != (Board->SideToMove == BLACK_PIECE))
+        {
+            goto End;
+        }
+        
+        index = (c[1] - '1') * 8 + (c[0] - 'a');
+        side  = (c[1] == '3') ? &Board->White : &Board->Black;
+        side->State.EnPassant = 0x1ULL << index;
+        c += 2;
+    }
+    
+    // Halfmove clock and fullmove number, when present
+    if (*c == ' ')
+    {
+        for (c++, Board->HalfmoveClock = 0; *c >= '0' && *c <= '9'; c++)
+        {
+            Board->HalfmoveClock = Board->HalfmoveClock * 10 + (*c - '0');
+        }
+        if (*c == ' ')
+        {
+            for (c++, Board->FullmoveNumber = 0; *c >= '0' && *c <= '9'; c++)
+            {
+                Board->FullmoveNumber = Board->FullmoveNumber * 10 + (*c - '0');
+            }
+        }
+    }
+    if (*c != '\0' || Board->FullmoveNumber == 0)
+    {
+        goto End;
+    }
+    
+    BoardRefresh(Board);
+    
+    // The side that just moved can't have left its king in check
+    if ((Board->SideToMove == WHITE_PIECE) ? PiecesIsKingInCheck(&Board->Black, &Board->White) :
+                                             PiecesIsKingInCheck(&Board->White, &Board->Black))
+    {
+        goto End;
+    }
+    isParsed = true;
+    
+End:
+    return isParsed;
+}
+
+/*
+ Function: BoardWriteNumberEx
+ Parameters:
+    - char* Text. Where the digits are written
+    - UInt64 Number. The number to write
+ Return:
+    char*. The character after the last digit written.
+ Notes:
+ */
+char* BoardWriteNumberEx(char* Text, UInt64 Number)
+{
+    char   digits[20];
+    UInt64 count = 0;
+    
+    do
+    {
+        digits[count++] = (char)('0' + Number % 10);
+        Number /= 10;
+    } while (Number != 0);
+    
+    while (count != 0)
+    {
+        *Text++ = digits[--count];
+    }
+    
+    return Text;
+}
+
+/*
+ Function: BoardToFEN
+ Parameters:
+    - Board* Board. The position to write
+    - char* FEN. At least BOARD_FEN_MAX characters, receives the FEN
+ Return:
+    UInt64. The length of the FEN written, not counting the null.
+ Notes:
+ */
+UInt64 BoardToFEN(Board* Board, char* FEN)
+{
+    const char* symbols = ".PNBRQK..pnbrqk";
+    char*       c = FEN;
+    char*       castle;
+    UInt64      empty, enPassantSquare, index;
+    UInt8       entry;
+    
+    for (Int64 rank = 7; rank >= 0; rank--)
+    {
+        empty = 0;
+        for (Int64 file = 0; file < 8; file++)
+        {
+            entry = Board->Mailbox[rank * 8 + file];
+            if (entry == NONE)
+            {
+                empty++;
+                continue;
+            }
+            if (empty != 0)
+            {
+                *c++ = (char)('0' + empty);
+                empty = 0;
+            }
+            *c++ = symbols[entry];
+        }
+        if (empty != 0)
+        {
+            *c++ = (char)('0' + empty);
+        }
+        if (rank != 0)
+        {
+            *c++ = '/';
+        }
+    }
+    
+    *c++ = ' ';
+    *c++ = (Board->SideToMove == WHITE_PIECE) ? 'w' : 'b';
+    *c++ = ' ';
+    
+    castle = c;
+    if ((Board->White.State.Castle & (KING_HAS_MOVED | KING_ROOK_HAS_MOVED)) == 0)
+    {
+        *c++ = 'K';
+    }
+    if ((Board->White.State.Castle & (KING_HAS_MOVED | QUEEN_ROOK_HAS_MOVED)) == 0)
+    {
+        *c++ = 'Q';
+    }
+    if ((Board->Black.State.Castle & (KING_HAS_MOVED | KING_ROOK_HAS_MOVED)) == 0)
+    {
+        *c++ = 'k';
+    }
+    if ((Board->Black.State.Castle & (KING_HAS_MOVED | QUEEN_ROOK_HAS_MOVED)) == 0)
+    {
+        *c++ = 'q';
+    }
+    if (c == castle)
+    {
+        *c++ = '-';
+    }
+    *c++ = ' ';
+    
+    enPassantSquare = Board->White.State.EnPassant | Board->Black.State.EnPassant;
+    if (enPassantSquare != 0)
+    {
+        index = LeastSigBitIndex(enPassantSquare);
+        *c++ = (char)('a' + (index & 0x7));
+        *c++ = (char)('1' + (index >> 3));
+    }
+    else
+    {
+        *c++ = '-';
+    }
+    
+    *c++ = ' ';
+    c = BoardWriteNumberEx(c, Board->HalfmoveClock);
+    *c++ = ' ';
+    c = BoardWriteNumberEx(c, Board->FullmoveNumber);
+    *c = '\0';
+    
+    return c - FEN;
+}
+
+/*
+ Function: BoardMakeMove
+ Parameters:
+    - Board* Board. The current chess board
+    - UInt64 Color. The color of the side making the move
+    - PackedMove Move. A legal move from BoardGenerateLegalMoves
+ Return:
+ Notes:
+    The move is played in place. What is needed to take it back is
+    pushed onto Board->History, so every BoardMakeMove must be paired
+    with a BoardUnmakeMove. The move is not checked for legality.
+    Board->Hash, Board->PawnHash and Board->Score are updated
+    incrementally; building with -DBOARD_DEBUG_HASH checks them
+    against BoardComputeHash, BoardComputePawnHash and
+    BoardComputeScore each move.
+ */
+void BoardMakeMove(Board* Board, UInt64 Color, PackedMove Move)
+{
+    BoardUndo* undo;
+    Pieces*    A, *B;
+    UInt64     startIndex, endIndex, captureIndex;
+    UInt64     startSquare, endSquare, captureSquare;
+    UInt64     flags, hash;
+    PieceType  movedType, capturedType;
+    
+    if (Color == WHITE_PIECE)
+    {
+        A = &Board->White;
+        B = &Board->Black;
+    }
+    else
+    {
+        A = &Board->Black;
+        B = &Board->White;
+    }
+    
+    startIndex    = MoveStartIndex(Move);
+    endIndex      = MoveEndIndex(Move);
+    captureIndex  = endIndex;
+    flags         = MoveFlags(Move);
+    
+    if (flags == MOVE_EN_PASSANT)
+    {
+        captureIndex = (Color == WHITE_PIECE) ? (endIndex - 8) : (endIndex + 8);
+    }
+    
+    startSquare   = 0x1ULL << startIndex;
+    endSquare     = 0x1ULL << endIndex;
+    captureSquare = 0x1ULL << captureIndex;
+    movedType     = MailboxType(Board->Mailbox[startIndex]);
+    capturedType  = MailboxType(Board->Mailbox[captureIndex]);
+    
+    undo = &Board->History[Board->Ply++];
+    undo->Move       = Move;
+    undo->Color      = (UInt8)Color;
+    undo->Moved      = (UInt8)movedType;
+    undo->Captured   = (UInt8)capturedType;
+    undo->WhiteState = Board->White.State;
+    undo->BlackState = Board->Black.State;
+    undo->Hash       = Board->Hash;
+    undo->PawnHash   = Board->PawnHash;
+    undo->HalfmoveClock = Board->HalfmoveClock;
+    undo->Score      = Board->Score;
+    
+    // Castle flags, the en passant file and the side to move are
+    // hashed out here and back in once the move is made
+    hash  = Board->Hash;
+    hash ^= Zobrist.Castle[WHITE_PIECE][Board->White.State.Castle & 0x7];
+    hash ^= Zobrist.Castle[BLACK_PIECE][Board->Black.State.Castle & 0x7];
+    hash ^= BoardEnPassantHashEx(Board);
+    if (Board->SideToMove == BLACK_PIECE)
+    {
+        hash ^= Zobrist.Side;
+    }
+    
+    *BoardPieceSetEx(A, movedType) ^= startSquare | endSquare;
+    A->Occupancy ^= startSquare | endSquare;
+    hash ^= Zobrist.Pieces[Color][movedType][startIndex] ^ Zobrist.Pieces[Color][movedType][endIndex];
+    BoardScorePieceEx(&Board->Score, Color, movedType, startIndex, -1);
+    BoardScorePieceEx(&Board->Score, Color, movedType, endIndex, 1);
+    if (movedType == PAWN)
+    {
+        Board->PawnHash ^= Zobrist.Pieces[Color][PAWN][startIndex] ^ Zobrist.Pieces[Color][PAWN][endIndex];
+    }
+    Board->Mailbox[endIndex]   = Board->Mailbox[startIndex];
+    Board->Mailbox[startIndex] = NONE;
+    
+    if (capturedType != NONE)
+    {
+        *BoardPieceSetEx(B, capturedType) ^= captureSquare;
+        B->Occupancy    ^= captureSquare;
+        hash            ^= Zobrist.Pieces[Color ^ 1][capturedType][captureIndex];
+        BoardScorePieceEx(&Board->Score, Color ^ 1, capturedType, captureIndex, -1);
+        if (capturedType == PAWN)
+        {
+            Board->PawnHash ^= Zobrist.Pieces[Color ^ 1][PAWN][captureIndex];
+        }
+        B->State.Castle |= BoardRookCastleFlagEx(B, captureSquare);
+        if (captureIndex != endIndex)
+        {
+            Board->Mailbox[captureIndex] = NONE;
+        }
+    }
+    
+    if (flags & MOVE_PROMOTION)
+    {
+        A->Pawns ^= endSquare;
+        *BoardPieceSetEx(A, (PieceType)MovePromotionPiece(Move)) |= endSquare;
+        hash ^= Zobrist.Pieces[Color][PAWN][endIndex] ^
+                Zobrist.Pieces[Color][MovePromotionPiece(Move)][endIndex];
+        BoardScorePieceEx(&Board->Score, Color, PAWN, endIndex, -1);
+        Board->PawnHash ^= Zobrist.Pieces[Color][PAWN][endIndex];
+        BoardScorePieceEx(&Board->Score, Color, (PieceType)MovePromotionPiece(Move), endIndex, 1);
+        Board->Mailbox[endIndex] = MailboxPiece(MovePromotionPiece(Move), Color);
+    }
+    else if (flags == MOVE_KING_CASTLE)
+    {
+        A->Rooks     ^= (endSquare << 1) | (endSquare >> 1);
+        A->Occupancy ^= (endSquare << 1) | (endSquare >> 1);
+        hash ^= Zobrist.Pieces[Color][ROOK][endIndex + 1] ^ Zobrist.Pieces[Color][ROOK][endIndex - 1];
+        BoardScorePieceEx(&Board->Score, Color, ROOK, endIndex + 1, -1);
+        BoardScorePieceEx(&Board->Score, Color, ROOK, endIndex - 1, 1);
+        Board->Mailbox[endIndex - 1] = Board->Mailbox[endIndex + 1];
+        Board->Mailbox[endIndex + 1] = NONE;
+    }
+    else if (flags == MOVE_QUEEN_CASTLE)
+    {
+        A->Rooks     ^= (endSquare >> 2) | (endSquare << 1);
+        A->Occupancy ^= (endSquare >> 2) | (endSquare << 1);
+        hash ^= Zobrist.Pieces[Color][ROOK][endIndex - 2] ^ Zobrist.Pieces[Color][ROOK][endIndex + 1];
+        BoardScorePieceEx(&Board->Score, Color, ROOK, endIndex - 2, -1);
+        BoardScorePieceEx(&Board->Score, Color, ROOK, endIndex + 1, 1);
+        Board->Mailbox[endIndex + 1] = Board->Mailbox[endIndex - 2];
+        Board->Mailbox[endIndex - 2] = NONE;
+    }
+    
+    Board->Occupancy = A->Occupancy | B->Occupancy;
+    
+    if (movedType == KING)
+    {
+        A->State.Castle |= KING_HAS_MOVED;
+    }
+    A->State.Castle |= BoardRookCastleFlagEx(A, startSquare);
+    
+    // Only the double push just made can be taken en passant
+    A->State.EnPassant = (flags == MOVE_DOUBLE_PUSH) ? (0x1ULL << ((startIndex + endIndex) / 2)) : 0;
+    B->State.EnPassant = 0;
+    
+    // The 50 move rule counts from the last capture or pawn move
+    Board->HalfmoveClock   = (movedType == PAWN || capturedType != NONE) ? 0 : Board->HalfmoveClock + 1;
+    Board->FullmoveNumber += (Color == BLACK_PIECE);
+    Board->SideToMove      = Color ^ 1;
+    
+    hash ^= Zobrist.Castle[WHITE_PIECE][Board->White.State.Castle & 0x7];
+    hash ^= Zobrist.Castle[BLACK_PIECE][Board->Black.State.Castle & 0x7];
+    if (flags == MOVE_DOUBLE_PUSH)
+    {
+        hash ^= BoardEnPassantHashEx(Board);
+    }
+    if (Board->SideToMove == BLACK_PIECE)
+    {
+        hash ^= Zobrist.Side;
+    }
+    Board->Hash = hash;
+    
+#ifdef BOARD_DEBUG_HASH
+    BoardScore score = BoardComputeScore(Board);
+    assert(Board->Hash == BoardComputeHash(Board));
+    assert(Board->PawnHash == BoardComputePawnHash(Board));
+    assert(Board->Score.Middlegame == score.Middlegame && Board->Score.Endgame == score.Endgame &&
+           Board->Score.Phase == score.Phase);
+#endif
+}
+
+/*
+ Function: BoardUnmakeMove
+ Parameters:
+    - Board* Board. The current chess board
+ Return:
+ Notes:
+    Takes back the move most recently played by BoardMakeMove.
+ */
+void BoardUnmakeMove(Board* Board)
+{
+    BoardUndo* undo;
+    Pieces*    A, *B;
+    UInt64     startIndex, endIndex, captureIndex;
+    UInt64     flags;
+    
+    undo = &Board->History[--Board->Ply];
+    
+    if (undo->Color == WHITE_PIECE)
+    {
+        A = &Board->White;
+        B = &Board->Black;
+    }
+    else
+    {
+        A = &Board->Black;
+        B = &Board->White;
+    }
+    
+    startIndex    = MoveStartIndex(undo->Move);
+    endIndex      = MoveEndIndex(undo->Move);
+    captureIndex  = endIndex;
+    flags         = MoveFlags(undo->Move);
+    
+    if (flags & MOVE_PROMOTION)
+    {
+        *BoardPieceSetEx(A, (PieceType)MovePromotionPiece(undo->Move)) ^= 0x1ULL << endIndex;
+        A->Pawns |= 0x1ULL << endIndex;
+    }
+    else if (flags == MOVE_KING_CASTLE)
+    {
+        A->Rooks     ^= (0x1ULL << (endIndex + 1)) | (0x1ULL << (endIndex - 1));
+        A->Occupancy ^= (0x1ULL << (endIndex + 1)) | (0x1ULL << (endIndex - 1));
+        Board->Mailbox[endIndex + 1] = Board->Mailbox[endIndex - 1];
+        Board->Mailbox[endIndex - 1] = NONE;
+    }
+    else if (flags == MOVE_QUEEN_CASTLE)
+    {
+        A->Rooks     ^= (0x1ULL << (endIndex - 2)) | (0x1ULL << (endIndex + 1));
+        A->Occupancy ^= (0x1ULL << (endIndex - 2)) | (0x1ULL << (endIndex + 1));
+        Board->Mailbox[endIndex - 2] = Board->Mailbox[endIndex + 1];
+        Board->Mailbox[endIndex + 1] = NONE;
+    }
+    else if (flags == MOVE_EN_PASSANT)
+    {
+        captureIndex = (undo->Color == WHITE_PIECE) ? (endIndex - 8) : (endIndex + 8);
+    }
+    
+    *BoardPieceSetEx(A, (PieceType)undo->Moved) ^= (0x1ULL << startIndex) | (0x1ULL << endIndex);
+    A->Occupancy ^= (0x1ULL << startIndex) | (0x1ULL << endIndex);
+    Board->Mailbox[startIndex] = MailboxPiece(undo->Moved, undo->Color);
+    Board->Mailbox[endIndex]   = NONE;
+    
+    if (undo->Captured != NONE)
+    {
+        *BoardPieceSetEx(B, (PieceType)undo->Captured) |= 0x1ULL << captureIndex;
+        B->Occupancy |= 0x1ULL << captureIndex;
+        Board->Mailbox[captureIndex] = MailboxPiece(undo->Captured, undo->Color ^ 1);
+    }
+    
+    Board->Occupancy   = A->Occupancy | B->Occupancy;
+    Board->White.State = undo->WhiteState;
+    Board->Black.State = undo->BlackState;
+    Board->SideToMove  = undo->Color;
+    Board->Hash        = undo->Hash;
+    Board->PawnHash    = undo->PawnHash;
+    Board->Score       = undo->Score;
+    Board->HalfmoveClock   = undo->HalfmoveClock;
+    Board->FullmoveNumber -= (undo->Color == BLACK_PIECE);
+    
+#ifdef BOARD_DEBUG_HASH
+    assert(Board->Hash == BoardComputeHash(Board));
+#endif
+}
+
+/*
+ Function: BoardAttemptMove
+ Parameters:
+    - Board* Board. The current chess board
+    - Move Move. The move to be attempted
+    - UInt64 Color. The color of the side making the move.
+    - bool ReturnPosition. When true, Board will be updated on exit.
+ Return:
+    bool - If the attempted move is legal, this function returns true,
+           false otherwise.
+ Notes:
+    If ReturnPosition is true, the board object passed in will be updated
+    with the legal move on exit. A promotion without a Promotion piece
+    matches any promotion piece, and the player is asked for it.
+ */
+bool BoardAttemptMove(Board* Board, Move Move, UInt64 Color, bool ReturnPosition = false)
+{
+    bool       isMoveLegal;
+    MoveList   moveList;
+    PackedMove move;
+    
+    isMoveLegal = false;
+    
+    if (Color != WHITE_PIECE && Color != BLACK_PIECE)
+    {
+        // Unknown color
         goto End;
     }
-
-
-    // A corresponding piece was found. Now find out if it's a legal move
-    // for that piece.
-    isMoveLegal = BoardCheckMoveIsLegalByPieceEx(&movingSide, &nonMovingSide, movingPieceType, Move);
-    if (isMoveLegal != true)
+    
+    // The move is legal exactly when the generator lists it
+    BoardGenerateLegalMoves(Board, Color, &moveList);
+    for (UInt64 i = 0; i < moveList.Count; i++)
+    {
+        move = moveList.Moves[i];
+        if ((0x1ULL << MoveStartIndex(move)) != Move.StartSquare ||
+            (0x1ULL << MoveEndIndex(move))   != Move.EndSquare)
+        {
+            continue;
+        }
+        
+        if (MoveIsPromotion(move) && Move.Promotion == NONE)
+        {
+            if (ReturnPosition == false)
+            {
+                isMoveLegal = true;
+                break;
+            }
+            Move.Promotion = BoardPromotionChoiceEx();
+        }
+        
+        if (Move.Promotion == MovePromotionPiece(move))
+        {
+            isMoveLegal = true;
+            break;
+        }
+    }
+    
+    if (isMoveLegal == false || ReturnPosition == false)
+    {
+        goto End;
+    }
+    
+    // Make the move. A game is not taken back, but its history is kept
+    // so a search can see repetitions of earlier game positions. Nothing
+    // before a capture or pawn move can repeat, so that much is dropped,
+    // and never more than BOARD_HISTORY_MAX plies are kept.
+    BoardMakeMove(Board, Color, move);
+    if (Board->HalfmoveClock == 0)
+    {
+        Board->Ply = 0;
+    }
+    else if (Board->Ply > BOARD_HISTORY_MAX)
+    {
+        memmove(&Board->History[0], &Board->History[1], BOARD_HISTORY_MAX * sizeof(BoardUndo));
+        Board->Ply = BOARD_HISTORY_MAX;
+    }
+    
+End:
+    return isMoveLegal;
+}
+
+/*
+ Function: BoardAddMoveEx
+ Parameters:
+    - MoveList* List. The list being filled
+    - UInt64 StartIndex. The square index the piece moves from
+    - UInt64 EndIndex. The square index the piece moves to
+    - UInt64 Flags. The MOVE_* flags of the move
+ Return:
+ Notes:
+ */
+inline void BoardAddMoveEx(MoveList* List, UInt64 StartIndex, UInt64 EndIndex, UInt64 Flags)
+{
+    List->Moves[List->Count++] = MoveMake(StartIndex, EndIndex, Flags);
+}
+
+/*
+ Function: BoardShiftEx
+ Parameters:
+    - UInt64 Squares. A board
+    - Int64 Offset. The number of squares to shift by
+ Return:
+    UInt64. Squares shifted towards h8 for a positive Offset,
+    towards a1 for a negative one.
+ Notes:
+ */
+inline UInt64 BoardShiftEx(UInt64 Squares, Int64 Offset)
+{
+    return (Offset > 0) ? (Squares << Offset) : (Squares >> -Offset);
+}
+
+/*
+ Function: BoardPieceAttacksEx
+ Parameters:
+    - PieceType PieceType. The kind of piece
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the piece
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The squares the piece attacks. Pawns are not handled.
+ Notes:
+ */
+inline UInt64 BoardPieceAttacksEx(PieceType PieceType, UInt64 Index, UInt64 Occupancy)
+{
+    switch (PieceType) {
+        case KNIGHT:
+            return PiecesKnightAttacks(Index);
+        case BISHOP:
+            return PiecesBishopAttacks(Index, Occupancy);
+        case ROOK:
+            return PiecesRookAttacks(Index, Occupancy);
+        case QUEEN:
+            return PiecesQueenAttacks(Index, Occupancy);
+        case KING:
+            return PiecesKingAttacks(Index);
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
+/*
+ Function: BoardPinnedPiecesEx
+ Parameters:
+    - Pieces* A. The side whose pins are wanted
+    - Pieces* B. The other side
+    - UInt64 KingIndex. The square index of A's king
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. A's pieces that are the only piece between their king
+    and an enemy slider.
+ Notes:
+ */
+UInt64 BoardPinnedPiecesEx(Pieces* A, Pieces* B, UInt64 KingIndex, UInt64 Occupancy)
+{
+    UInt64 snipers, blockers;
+    UInt64 pinned = 0;
+    UInt64 bPLocation = B->Occupancy;
+    
+    // Sliders that would see the king if A's own pieces were removed
+    snipers = (PiecesRookAttacks(KingIndex, bPLocation)   & (B->Rooks   | B->Queen)) |
+              (PiecesBishopAttacks(KingIndex, bPLocation) & (B->Bishops | B->Queen));
+    
+    while (snipers != 0)
+    {
+        blockers = PiecesBetween(KingIndex, PopLeastSigBit(&snipers)) & Occupancy;
+        if (BitCount(blockers) == 1)
+        {
+            pinned |= blockers;
+        }
+    }
+    
+    return pinned & A->Occupancy;
+}
+
+/*
+ Function: BoardAddPawnMovesEx
+ Parameters:
+    - MoveList* List. The list being filled
+    - UInt64 Targets. The end squares of pawns that moved by Offset
+    - Int64 Offset. The square offset from start to end square
+    - UInt64 Flags. MOVE_QUIET, MOVE_DOUBLE_PUSH or MOVE_CAPTURE
+    - UInt64 Pinned. The pinned pieces of the moving side
+    - UInt64 KingIndex. The square index of the moving side's king
+ Return:
+ Notes:
+    A pinned pawn may only move along the line through its king.
+    Moves onto the last rank are added once per promotion piece.
+ */
+void BoardAddPawnMovesEx(MoveList* List, UInt64 Targets, Int64 Offset, UInt64 Flags, UInt64 Pinned, UInt64 KingIndex)
+{
+    UInt64 startIndex, endIndex;
+    
+    while (Targets != 0)
+    {
+        endIndex   = PopLeastSigBit(&Targets);
+        startIndex = endIndex - Offset;
+        
+        if ((Pinned & (0x1ULL << startIndex)) &&
+            (PiecesLine(KingIndex, startIndex) & (0x1ULL << endIndex)) == 0)
+        {
+            continue;
+        }
+        
+        if ((0x1ULL << endIndex) & (RANK_1 | RANK_8))
+        {
+            BoardAddMoveEx(List, startIndex, endIndex, Flags | MOVE_PROMOTION_QUEEN);
+            BoardAddMoveEx(List, startIndex, endIndex, Flags | MOVE_PROMOTION_ROOK);
+            BoardAddMoveEx(List, startIndex, endIndex, Flags | MOVE_PROMOTION_BISHOP);
+            BoardAddMoveEx(List, startIndex, endIndex, Flags | MOVE_PROMOTION_KNIGHT);
+        }
+        else
+        {
+            BoardAddMoveEx(List, startIndex, endIndex, Flags);
+        }
+    }
+}
+
+/*
+ Function: BoardIsEnPassantLegalEx
+ Parameters:
+    - Pieces* A. The capturing side
+    - Pieces* B. The side whose pawn is captured
+    - UInt64 StartSquare. The capturing pawn
+    - UInt64 EndSquare. The en passant square
+    - UInt64 Checkers. B's pieces giving check
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    bool - True if the capture does not leave A's king in check.
+ Notes:
+    En passant removes two pieces from one rank, which the pin mask
+    cannot describe, so the slider attacks on the king are redone
+    with the occupancy after the capture.
+ */
+bool BoardIsEnPassantLegalEx(Pieces* A, Pieces* B, UInt64 StartSquare, UInt64 EndSquare, UInt64 Checkers, UInt64 Occupancy)
+{
+    UInt64 kingIndex, captured;
+    
+    if (A->King == 0)
+    {
+        return true;
+    }
+    
+    kingIndex = LeastSigBitIndex(A->King);
+    captured  = (B->Color == WHITE_PIECE) ? (EndSquare << 8) : (EndSquare >> 8);
+    Occupancy = (Occupancy ^ StartSquare ^ captured) | EndSquare;
+    
+    // A knight or pawn check can only be answered by taking the pawn
+    if (Checkers & (B->Knights | B->Pawns) & ~captured)
+    {
+        return false;
+    }
+    
+    return ((PiecesBishopAttacks(kingIndex, Occupancy) & (B->Bishops | B->Queen)) == 0 &&
+            (PiecesRookAttacks(kingIndex, Occupancy)   & (B->Rooks   | B->Queen)) == 0);
+}
+
+/*
+ Function: BoardCastleTargetsEx
+ Parameters:
+    - Pieces* A. The castling side
+    - Pieces* B. The other side
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The end squares of the king for every castle A may make.
+ Notes:
+    The king and rook must not have moved, the rook must still be on
+    its square, the squares between them must be empty, and the king
+    may not pass over or land on an attacked square. The caller makes
+    sure the king is not in check.
+ */
+UInt64 BoardCastleTargetsEx(Pieces* A, Pieces* B, UInt64 Occupancy)
+{
+    UInt64 targets = 0;
+    UInt64 kingIndex;
+    UInt64 backRank;
+    
+    backRank = (A->Color == WHITE_PIECE) ? RANK_1 : RANK_8;
+    
+    if ((A->State.Castle & KING_HAS_MOVED) ||
+        A->King != ((e1 | e8) & backRank))
+    {
+        return 0;
+    }
+    
+    kingIndex = LeastSigBitIndex(A->King);
+    
+    if ((A->State.Castle & KING_ROOK_HAS_MOVED) == 0 &&
+        (A->Rooks & (h1 | h8) & backRank) &&
+        (Occupancy & (f1 | g1 | f8 | g8) & backRank) == 0 &&
+        PiecesIsSquareAttacked(B, kingIndex + 1, Occupancy) == false &&
+        PiecesIsSquareAttacked(B, kingIndex + 2, Occupancy) == false)
+    {
+        targets |= (g1 | g8) & backRank;
+    }
+    
+    if ((A->State.Castle & QUEEN_ROOK_HAS_MOVED) == 0 &&
+        (A->Rooks & (a1 | a8) & backRank) &&
+        (Occupancy & (b1 | c1 | d1 | b8 | c8 | d8) & backRank) == 0 &&
+        PiecesIsSquareAttacked(B, kingIndex - 1, Occupancy) == false &&
+        PiecesIsSquareAttacked(B, kingIndex - 2, Occupancy) == false)
+    {
+        targets |= (c1 | c8) & backRank;
+    }
+    
+    return targets;
+}
+
+/*
+ Function: BoardGenerateMovesEx
+ Parameters:
+    - Board* Board. The current chess board
+    - UInt64 Color. The color of the side to generate moves for
+    - MoveList* List. Filled with the legal moves of Color asked for
+    - UInt64 Kinds. BOARD_GENERATE_CAPTURES, BOARD_GENERATE_QUIETS
+      or both
+ Return:
+ Notes:
+    Checkers, pinned pieces and the check evasion mask are worked out
+    once, so only legal moves are emitted and no move is played to
+    test it. Only king moves and en passant look at attacks per move.
+    Promotions are listed once per promotion piece, and castles are
+    listed as the king's two square move, each packed with its MOVE_*
+    flags. Captures are every move taking a piece, en passant and
+    every promotion; quiets are the rest. The list lives on the
+    caller's stack; no legal position has more than MAX_MOVES moves.
+ */
+void BoardGenerateMovesEx(Board* Board, UInt64 Color, MoveList* List, UInt64 Kinds)
+{
+    Pieces* A, *B;
+    UInt64 bPLocation, occupancy;
+    UInt64 checkers, pinned, checkMask;
+    UInt64 pieces, targets, captures;
+    UInt64 singlePush, doublePushRank;
+    UInt64 captureMask, quietMask, pushMask;
+    UInt64 kingIndex, startIndex, endIndex;
+    UInt64 enPassantSquare;
+    Int64  forward;
+    
+    List->Count = 0;
+    
+    if (Color == WHITE_PIECE)
+    {
+        A = &Board->White;
+        B = &Board->Black;
+        forward = 8;
+        doublePushRank = RANK_3;
+    }
+    else
     {
-        goto End;
+        A = &Board->Black;
+        B = &Board->White;
+        forward = -8;
+        doublePushRank = RANK_6;
     }
     
+    bPLocation = B->Occupancy;
+    occupancy  = Board->Occupancy;
     
-    // Make the move
-    // First find out if the ending square is occupied with the opposite color
-    nonMovingPieceType = PiecesMapSquareToPiece(&nonMovingSide, Move.EndSquare);
+    // The end squares each kind of move may go to, and which pushes are
+    // wanted: those onto the last rank promote, so count as captures
+    captureMask = (Kinds & BOARD_GENERATE_CAPTURES) ? bPLocation : 0;
+    quietMask   = (Kinds & BOARD_GENERATE_QUIETS) ? ~occupancy : 0;
+    pushMask    = ((Kinds & BOARD_GENERATE_CAPTURES) ? (RANK_1 | RANK_8) : 0) |
+                  ((Kinds & BOARD_GENERATE_QUIETS) ? ~(RANK_1 | RANK_8) : 0);
     
-    // Flip the bits to represent the move
-    BoardCompleteMoveEx(&movingSide, movingPieceType, &nonMovingSide, nonMovingPieceType, Move);
+    checkers  = 0;
+    pinned    = 0;
+    checkMask = ~0ULL;
+    kingIndex = 0;
     
-    // Now validate if the moving side is under check.
-    // Get the attacked squares of the opposite color
-    attackedSquares = PiecesGetAttackSquares(&nonMovingSide, &movingSide);
-    if (movingSide.King & attackedSquares)
+    if (A->King != 0)
     {
-        // King is in check, previous move is not legal
-        isMoveLegal = false;
-        goto End;
+        kingIndex = LeastSigBitIndex(A->King);
+        checkers  = PiecesAttackersTo(B, kingIndex, occupancy);
+        pinned    = BoardPinnedPiecesEx(A, B, kingIndex, occupancy);
+        
+        // King moves. The king is lifted off the board so that
+        // sliders checking it also cover the squares behind it.
+        targets = PiecesKingAttacks(kingIndex) & (captureMask | quietMask);
+        while (targets != 0)
+        {
+            endIndex = PopLeastSigBit(&targets);
+            if (PiecesIsSquareAttacked(B, endIndex, occupancy ^ A->King) == false)
+            {
+                BoardAddMoveEx(List, kingIndex, endIndex,
+                               ((0x1ULL << endIndex) & bPLocation) ? MOVE_CAPTURE : MOVE_QUIET);
+            }
+        }
+        
+        if (checkers == 0 && (Kinds & BOARD_GENERATE_QUIETS))
+        {
+            targets = BoardCastleTargetsEx(A, B, occupancy);
+            if (targets & (g1 | g8))
+            {
+                BoardAddMoveEx(List, kingIndex, kingIndex + 2, MOVE_KING_CASTLE);
+            }
+            if (targets & (c1 | c8))
+            {
+                BoardAddMoveEx(List, kingIndex, kingIndex - 2, MOVE_QUEEN_CASTLE);
+            }
+        }
+        
+        // Only the king can answer a double check
+        if (BitCount(checkers) > 1)
+        {
+            return;
+        }
+        
+        // Otherwise the checker must be taken or blocked
+        if (checkers != 0)
+        {
+            checkMask = checkers | PiecesBetween(kingIndex, LeastSigBitIndex(checkers));
+        }
     }
     
-    // The resulting move is legal
-    isMoveLegal = true;
+    // Pawns, generated set-wise by direction
+    singlePush = Intersect(BoardShiftEx(A->Pawns, forward), occupancy);
+    targets    = Intersect(BoardShiftEx(singlePush & doublePushRank, forward), occupancy);
+    BoardAddPawnMovesEx(List, singlePush & checkMask & pushMask, forward, MOVE_QUIET, pinned, kingIndex);
+    BoardAddPawnMovesEx(List, targets & checkMask & quietMask, 2 * forward, MOVE_DOUBLE_PUSH, pinned, kingIndex);
     
-    // Update the Board if the caller requested
-    if (ReturnPosition == true)
+    if (Kinds & BOARD_GENERATE_CAPTURES)
     {
-        if (Color == WHITE_PIECE)
+        targets = Intersect(BoardShiftEx(A->Pawns, forward - 1), FILE_H) & bPLocation;
+        BoardAddPawnMovesEx(List, targets & checkMask, forward - 1, MOVE_CAPTURE, pinned, kingIndex);
+        targets = Intersect(BoardShiftEx(A->Pawns, forward + 1), FILE_A) & bPLocation;
+        BoardAddPawnMovesEx(List, targets & checkMask, forward + 1, MOVE_CAPTURE, pinned, kingIndex);
+        
+        enPassantSquare = B->State.EnPassant;
+        if (enPassantSquare != 0)
         {
-            memcpy(&Board->White, &movingSide, sizeof(Pieces));
-            memcpy(&Board->Black, &nonMovingSide, sizeof(Pieces));
-            // Update the last move to be this move
-            Board->White.State.LastMove       = Move;
-            Board->White.State.LastMovedPiece = movingPieceType;
-            memset(&Board->Black.State.LastMove, 0, sizeof(Move));
-            Board->Black.State.LastMovedPiece = NONE;
+            pieces = PiecesPawnAttacks(B->Color, LeastSigBitIndex(enPassantSquare)) & A->Pawns;
+            while (pieces != 0)
+            {
+                startIndex = PopLeastSigBit(&pieces);
+                if (BoardIsEnPassantLegalEx(A, B, 0x1ULL << startIndex, enPassantSquare, checkers, occupancy))
+                {
+                    BoardAddMoveEx(List, startIndex, LeastSigBitIndex(enPassantSquare), MOVE_EN_PASSANT);
+                }
+            }
         }
-        else
+    }
+    
+    // Knights, bishops, rooks and queens
+    for (UInt64 pieceType = KNIGHT; pieceType <= QUEEN; pieceType++)
+    {
+        pieces = BoardPiecesOfTypeEx(A, (PieceType)pieceType);
+        while (pieces != 0)
         {
-            memcpy(&Board->Black, &movingSide, sizeof(Pieces));
-            memcpy(&Board->White, &nonMovingSide, sizeof(Pieces));
-            // Update the last move to be this move
-            Board->Black.State.LastMove       = Move;
-            Board->Black.State.LastMovedPiece = movingPieceType;
-            memset(&Board->White.State.LastMove, 0, sizeof(Move));
-            Board->White.State.LastMovedPiece = NONE;
+            startIndex = PopLeastSigBit(&pieces);
+            targets    = BoardPieceAttacksEx((PieceType)pieceType, startIndex, occupancy);
+            targets   &= (captureMask | quietMask) & checkMask;
+            
+            if (pinned & (0x1ULL << startIndex))
+            {
+                targets &= PiecesLine(kingIndex, startIndex);
+            }
+            
+            captures = targets & bPLocation;
+            targets ^= captures;
+            while (captures != 0)
+            {
+                BoardAddMoveEx(List, startIndex, PopLeastSigBit(&captures), MOVE_CAPTURE);
+            }
+            while (targets != 0)
+            {
+                BoardAddMoveEx(List, startIndex, PopLeastSigBit(&targets), MOVE_QUIET);
+            }
         }
     }
-    
-End:
-    return isMoveLegal;
 }
 
 /*
- Function: BoardFindNextPieceEx
+ Function: BoardGenerateLegalMoves
  Parameters:
-    - Pieces* A. The side we're looking at.
-    - PieceType PieceType. The kind of piece
-    - UInt64 StartSquare. Starting square on the board.
+    - Board* Board. The current chess board
+    - UInt64 Color. The color of the side to generate moves for
+    - MoveList* List. Filled with every legal move of Color
  Return:
-    UInt64 - The next square which has a piece of PieceType. 0 otherwise if there's no more
- Note:
-     This is a helper function for BoardPieceTypeHasLegalMovesEx.
-     It returns, the next piece on the board that's of type
-     PieceType starting from StartSquare.
+ Notes:
  */
-
-inline UInt64 BoardFindNextMoveEx(UInt64 LegalMoves, UInt64 StartSquare)
+void BoardGenerateLegalMoves(Board* Board, UInt64 Color, MoveList* List)
 {
-    UInt64 nextMoveLocation;
-    UInt64 aMoves;
-    UInt64 mask;
-    
-    if (StartSquare == NO_SQUARE)
-    {
-        nextMoveLocation = 0;
-        goto End;
-    }
-    
-    aMoves  = StartSquare;
-    mask    = ~(aMoves - 1);
-    aMoves  = mask & LegalMoves;
-    aMoves  = LeastSigBit(aMoves);
-    
-    nextMoveLocation = aMoves;
-    
-End:
-    return nextMoveLocation;
+    BoardGenerateMovesEx(Board, Color, List, BOARD_GENERATE_CAPTURES | BOARD_GENERATE_QUIETS);
 }
 
 /*
- Function: BoardFindNextPieceEx
+ Function: BoardGenerateCaptures
  Parameters:
-    - Pieces* A. The side we're looking at.
-    - PieceType PieceType. The kind of piece
-    - UInt64 StartSquare. Starting square on the board.
+    - Board* Board. The current chess board
+    - UInt64 Color. The color of the side to generate moves for
+    - MoveList* List. Filled with Color's legal captures and promotions
  Return:
-    UInt64 - The next square which has a piece of PieceType. 0 otherwise if there's no more
- Note:
-    This is a helper function for BoardPieceTypeHasLegalMovesEx.
-    It returns, the next piece on the board that's of type
-    PieceType starting from StartSquare.
+ Notes:
  */
-inline UInt64 BoardFindNextPieceEx(Pieces* A, PieceType PieceType, UInt64 StartSquare)
+void BoardGenerateCaptures(Board* Board, UInt64 Color, MoveList* List)
 {
-    UInt64 nextPiece;
-    UInt64 aPiece;
-    UInt64 mask;
-    
-    if (StartSquare == NO_SQUARE)
-    {
-        nextPiece = 0;
-        goto End;
-    }
-    
-    nextPiece = NO_SQUARE;
-    
-    switch (PieceType) {
-        case PAWN:
-            aPiece = A->Pawns;
-            break;
-        case KNIGHT:
-            aPiece = A->Knights;
-            break;
-        case BISHOP:
-            aPiece = A->Bishops;
-            break;
-        case ROOK:
-            aPiece = A->Rooks;
-            break;
-        case QUEEN:
-            aPiece = A->Queen;
-            break;
-        case KING:
-            aPiece = A->King;
-            break;
-        default:
-            aPiece = 0x0;
-            break;
-    }
-    
-    mask    = (StartSquare - 1);
-    aPiece &= ~mask;
-    aPiece  = LeastSigBit(aPiece);
-    
-    nextPiece = aPiece;
-    
-End:
-    return nextPiece;
+    BoardGenerateMovesEx(Board, Color, List, BOARD_GENERATE_CAPTURES);
 }
 
 /*
- Function: BoardGetPieceMoveCallbackEx
+ Function: BoardGenerateQuiets
  Parameters:
-    - PieceType PieceType. The kind of piece being moved.
+    - Board* Board. The current chess board
+    - UInt64 Color. The color of the side to generate moves for
+    - MoveList* List. Filled with Color's legal moves that neither
+      capture nor promote
  Return:
-    (Piece*, Piece*) -> UInt64. The associated Pieces*Move callback
-        for the piece.
- Note:
+ Notes:
  */
-UInt64 (*BoardGetPieceMoveCallbackEx(PieceType PieceType))(Pieces*, Pieces*)
+void BoardGenerateQuiets(Board* Board, UInt64 Color, MoveList* List)
 {
-    switch (PieceType) {
-        case PAWN:
-            return PiecesPawnMove;
-        case KNIGHT:
-            return PiecesKnightMove;
-        case BISHOP:
-            return PiecesBishopMove;
-        case ROOK:
-            return PiecesRookMove;
-        case QUEEN:
-            return PiecesQueenMove;
-        case KING:
-            return PiecesKingMove;
-        default:
-            break;
-    }
-    
-    return nullptr;
+    BoardGenerateMovesEx(Board, Color, List, BOARD_GENERATE_QUIETS);
 }
 
 /*
- Function: BoardPieceHasLegalMovesEx
+ Function: BoardIsMoveLegal
  Parameters:
-    - Pieces* A. Pieces for attacking side
-    - Pieces* B. Pieces for attacked side
-    - UInt64 LegalMoves. The legal moves for the piece at PieceLocation
-    - UInt64 PieceLocation. The square the piece is located on the board
-    - PieceType MovingSidePieceType. The kind of piece being moved.
-    - (Pieces*, Pieces*) -> GameResult. The function checking the desired game result.
+    - Board* Board. The current chess board
+    - UInt64 Color. The side to move
+    - PackedMove Move. Any 16 bit value
  Return:
-     GameResult - Checks the current status of the board.
-                 The results can be:
-                 0x0 = Progressing
-                 0x1 = A has Checkmated B
-                 0x2 = A has drawn B. (Includes stalemate)
- Note:
-    This is a helper function for BoardGameStatus. This function
-    iterates through all the moves for the piece at PieceLocation.
-    It then calls the GameResultCallback to see if it analysis should
-    continue or stop.
+    bool. True if Move is one BoardGenerateLegalMoves would list.
+ Notes:
+    Checks a single move, such as one from the transposition table,
+    without generating the others: the piece and flags must match
+    the board, the piece must reach the end square, and the move
+    must not leave the king in check, which is tested with the same
+    check and pin masks the generator uses.
  */
-GameResult BoardPieceHasLegalMovesEx(Pieces* A,
-                               Pieces* B,
-                               UInt64 LegalMoves,
-                               UInt64 PieceLocation,
-                               PieceType MovingSidePieceType,
-                               GameResult (*GameResultCallback)(Pieces*, Pieces*))
+bool BoardIsMoveLegal(Board* Board, UInt64 Color, PackedMove Move)
 {
-    Move move;
-    GameResult gameProgress;
-    UInt64 endSquare;
-    UInt64 attackedSquares;
-    PieceType nonMovingPieceType;
-    Pieces nonMovingSide, movingSide;
-    
-    gameProgress = Unknown;
-    endSquare  = a1;
-    move.StartSquare = PieceLocation;
-    
-    memcpy(&movingSide, B, sizeof(Pieces));
-    memcpy(&nonMovingSide, A, sizeof(Pieces));
+    Pieces* A, *B;
+    UInt64 startIndex  = MoveStartIndex(Move);
+    UInt64 endIndex    = MoveEndIndex(Move);
+    UInt64 flags       = MoveFlags(Move);
+    UInt64 startSquare = 0x1ULL << startIndex;
+    UInt64 endSquare   = 0x1ULL << endIndex;
+    UInt64 occupancy   = Board->Occupancy;
+    UInt64 checkers, kingIndex, targets;
+    Int64  forward;
+    PieceType movedType;
+    bool   isMoveLegal = false;
     
-    endSquare = BoardFindNextMoveEx(LegalMoves, endSquare);
+    if (Color == WHITE_PIECE)
+    {
+        A = &Board->White;
+        B = &Board->Black;
+        forward = 8;
+    }
+    else
+    {
+        A = &Board->Black;
+        B = &Board->White;
+        forward = -8;
+    }
     
-    while (endSquare != NO_SQUARE)
+    // The mover must be Color's, and the flags must match the end square
+    if (Move == 0 || flags == 0x6 || flags == 0x7 ||
+        (startSquare & A->Occupancy) == 0 || (endSquare & A->Occupancy) != 0)
     {
-        move.EndSquare = endSquare;
-        nonMovingPieceType = PiecesMapSquareToPiece(A, endSquare);
-        
-        BoardCompleteMoveEx(&movingSide, MovingSidePieceType, &nonMovingSide, nonMovingPieceType, move);
-        
-        // Get the result from the passed in callback
-        gameProgress = GameResultCallback(&movingSide, &nonMovingSide);
-        if (gameProgress == Progressing)
+        goto End;
+    }
+    if (flags == MOVE_EN_PASSANT)
+    {
+        if (endSquare != B->State.EnPassant)
         {
             goto End;
         }
-        
-        // Increment to the next square to find the next legal move
-        endSquare <<= 1;
-        // Find the next legal move and see if that move leads
-        // B king to no longer be in check
-        endSquare = BoardFindNextMoveEx(LegalMoves, endSquare);
     }
-End:
-    return gameProgress;
-}
-
-/*
- Function: BoardPieceTypeHasLegalMovesEx
- Parameters:
-    - Pieces* A. Pieces for attacking side
-    - Pieces* B. Pieces for attacked side
-    - PieceType. The kind of piece B will move to see if legal
-    - (Pieces*, Pieces*) -> GameResult. The function checking the desired game result.
- Return:
- GameResult - Checks the current status of the board.
-              The results can be:
-              0x0 = Progressing
-              0x1 = A has Checkmated B
-              0x2 = A has drawn B. (Includes stalemate)
- Note:
-    This is a helper function for BoardGameStatus. This function
-    iterates through all the pieces for a given PieceType and then
-    iterates through each of their moves to see if legal.
- */
-GameResult BoardPieceTypeHasLegalMovesEx(Pieces* A, Pieces* B, PieceType PieceType, GameResult (*GameResultCallback)(Pieces*, Pieces*))
-{
-    UInt64 startSquare = a1;
-    UInt64 pieceLocation, legalMoves;
-    UInt64 (*PieceMoveCallback)(Pieces*, Pieces*);
-    GameResult gameProgress = Unknown;
+    else if (MoveIsCapture(Move) != ((endSquare & B->Occupancy) != 0))
+    {
+        goto End;
+    }
     
-    // While there are still pieces of this piece type
-    // get that piece location and the routine for finding its moves.
-    pieceLocation     = BoardFindNextPieceEx(B, PieceType, startSquare);
-    PieceMoveCallback = BoardGetPieceMoveCallbackEx(PieceType);
+    movedType = MailboxType(Board->Mailbox[startIndex]);
+    switch (movedType) {
+        case PAWN:
+            if (MoveIsPromotion(Move) != ((endSquare & (RANK_1 | RANK_8)) != 0))
+            {
+                goto End;
+            }
+            if (MoveIsCapture(Move))
+            {
+                targets = PiecesPawnAttacks(Color, startIndex);
+            }
+            else if (flags == MOVE_DOUBLE_PUSH)
+            {
+                targets = BoardShiftEx(startSquare & (RANK_2 | RANK_7), 2 * forward) &
+                          ~BoardShiftEx(occupancy, forward) & (RANK_4 | RANK_5);
+            }
+            else if (flags == MOVE_QUIET || MoveIsPromotion(Move))
+            {
+                targets = BoardShiftEx(startSquare, forward);
+            }
+            else
+            {
+                goto End;
+            }
+            if ((targets & endSquare) == 0)
+            {
+                goto End;
+            }
+            break;
+        case KING:
+            if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE)
+            {
+                isMoveLegal = endIndex == ((flags == MOVE_KING_CASTLE) ? startIndex + 2 : startIndex - 2) &&
+                              PiecesAttackersTo(B, startIndex, occupancy) == 0 &&
+                              (BoardCastleTargetsEx(A, B, occupancy) & endSquare) != 0;
+                goto End;
+            }
+            isMoveLegal = (flags == MOVE_QUIET || flags == MOVE_CAPTURE) &&
+                          (PiecesKingAttacks(startIndex) & endSquare) != 0 &&
+                          PiecesIsSquareAttacked(B, endIndex, occupancy ^ startSquare) == false;
+            goto End;
+        default:
+            if ((flags != MOVE_QUIET && flags != MOVE_CAPTURE) ||
+                (BoardPieceAttacksEx(movedType, startIndex, occupancy) & endSquare) == 0)
+            {
+                goto End;
+            }
+            break;
+    }
     
-    // Get the legal moves for this piece type. If there are none, return.
-    if ((legalMoves = PieceMoveCallback(B, A)) == 0)
+    if (A->King == 0)
     {
+        isMoveLegal = true;
         goto End;
     }
     
-    while (pieceLocation != NO_SQUARE)
+    // The move may not leave the king in check
+    kingIndex = LeastSigBitIndex(A->King);
+    checkers  = PiecesAttackersTo(B, kingIndex, occupancy);
+    if (flags == MOVE_EN_PASSANT)
     {
-        gameProgress = BoardPieceHasLegalMovesEx(A, B, legalMoves, pieceLocation, PieceType, GameResultCallback);
-        if (gameProgress == Progressing)
-        {
-            goto End;
-        }
-        
-        startSquare   = (pieceLocation << 1);
-        pieceLocation = BoardFindNextPieceEx(B, PieceType, startSquare);
+        isMoveLegal = BoardIsEnPassantLegalEx(A, B, startSquare, endSquare, checkers, occupancy);
+        goto End;
+    }
+    if (BitCount(checkers) > 1 ||
+        (checkers != 0 && (endSquare & (checkers | PiecesBetween(kingIndex, LeastSigBitIndex(checkers)))) == 0))
+    {
+        goto End;
+    }
+    if ((BoardPinnedPiecesEx(A, B, kingIndex, occupancy) & startSquare) &&
+        (PiecesLine(kingIndex, startIndex) & endSquare) == 0)
+    {
+        goto End;
     }
+    isMoveLegal = true;
     
 End:
-    return gameProgress;
+    return isMoveLegal;
 }
 
 /*
- Function: BoardGameStatus
+ Function: BoardSEE
  Parameters:
-    - Pieces* A. Pieces for attacking side
-    - Pieces* B. Pieces for attacked side
-    - (Pieces*, Pieces*) -> GameResult. The function checking the desired game result.
+    - Board* Board. The current chess board
+    - PackedMove Move. A legal move of the side to move
  Return:
-    GameResult - Checks the current status of the board.
-                 The results can be:
-                 0x0 = Progressing
-                 0x1 = A has Checkmated B
-                 0x2 = A has drawn B. (Includes stalemate)
- 
- Note:
-    This function is fairly expensive; avoid calling it frequently.
-    Draws are stalemates, one minor piece two kings, two knights two kings.
-    Repetition draws are not detected within this function.
- 
+    Int32. The material in centipawns the side to move wins, or loses
+    if negative, over the exchange Move starts on its end square.
+ Notes:
+    Static exchange evaluation: both sides recapture on the square
+    with their least valuable attacker for as long as it pays, and
+    each side may stop instead of recapturing. Each piece taken off
+    the board uncovers any bishop, rook or queen behind it on the
+    same line, which then joins the attackers. Pins and checks are
+    not looked at. Nothing is played on the board.
  */
-GameResult BoardGameStatus(Pieces* A, Pieces* B, GameResult (*GameResultCallback)(Pieces*, Pieces*))
+Int32 BoardSEE(Board* Board, PackedMove Move)
 {
-    GameResult gameProgress = Unknown;
+    Pieces* sides[2] = {&Board->White, &Board->Black};
+    UInt64  startIndex = MoveStartIndex(Move);
+    UInt64  endIndex   = MoveEndIndex(Move);
+    UInt64  occupancy  = Board->Occupancy ^ (0x1ULL << startIndex);
+    UInt64  color      = MailboxColor(Board->Mailbox[startIndex]);
+    UInt64  attackers, diagonal, straight, pieces;
+    Int32   gain[32];
+    UInt64  depth = 0;
+    PieceType attacker;
+    
+    // What the first capture wins, and the piece left standing on the square
+    attacker = MailboxType(Board->Mailbox[startIndex]);
+    gain[0]  = BoardPieceValues[MailboxType(Board->Mailbox[endIndex])];
+    if (MoveFlags(Move) == MOVE_EN_PASSANT)
+    {
+        gain[0]    = BoardPieceValues[PAWN];
+        occupancy ^= (color == WHITE_PIECE) ? (0x1ULL << (endIndex - 8)) : (0x1ULL << (endIndex + 8));
+    }
+    if (MoveIsPromotion(Move))
+    {
+        attacker  = (PieceType)MovePromotionPiece(Move);
+        gain[0]  += BoardPieceValues[attacker] - BoardPieceValues[PAWN];
+    }
     
-    // Iterate through all the moves B and re-evaluate the board
-    // with the passed callback
-    for (UInt64 pieceType = KING; pieceType > NONE; pieceType--)
+    diagonal  = Board->White.Bishops | Board->White.Queen | Board->Black.Bishops | Board->Black.Queen;
+    straight  = Board->White.Rooks   | Board->White.Queen | Board->Black.Rooks   | Board->Black.Queen;
+    attackers = (PiecesAttackersTo(&Board->White, endIndex, occupancy) |
+                 PiecesAttackersTo(&Board->Black, endIndex, occupancy)) & occupancy;
+    
+    while (depth < 31)
     {
-        gameProgress = BoardPieceTypeHasLegalMovesEx(A, B, (PieceType)pieceType, GameResultCallback);
-        if (gameProgress == Progressing)
+        color ^= 1;
+        
+        // The least valuable piece of the side to recapture
+        pieces = 0;
+        for (UInt64 pieceType = PAWN; pieceType <= KING && pieces == 0; pieceType++)
         {
-            goto End;
+            pieces = BoardPiecesOfTypeEx(sides[color], (PieceType)pieceType) & attackers;
+            if (pieces != 0)
+            {
+                depth++;
+                gain[depth] = BoardPieceValues[attacker] - gain[depth - 1];
+                attacker    = (PieceType)pieceType;
+            }
+        }
+        if (pieces == 0)
+        {
+            break;
+        }
+        
+        // Neither side can do better by going on
+        if (((-gain[depth - 1] > gain[depth]) ? -gain[depth - 1] : gain[depth]) < 0)
+        {
+            break;
         }
+        
+        occupancy ^= LeastSigBit(pieces);
+        attackers |= (PiecesBishopAttacks(endIndex, occupancy) & diagonal) |
+                     (PiecesRookAttacks(endIndex, occupancy)   & straight);
+        attackers &= occupancy;
     }
     
-End:
-    return gameProgress;
+    // Each side takes the better of recapturing and stopping, from the last capture back
+    while (depth > 0)
+    {
+        depth--;
+        gain[depth] = -((-gain[depth] > gain[depth + 1]) ? -gain[depth] : gain[depth + 1]);
+    }
+    
+    return gain[0];
 }
 
-
 /*
- Function: BoardIsKingCheckmatedEx
+ Function: BoardSEE
  Parameters:
- - Pieces* A. Pieces for attacking side
- - Pieces* B. Pieces for attacked side
+    - Board* Board. The current chess board
+    - Move Move. A legal move of the side to move
  Return:
-    GameResult - Checkmated if current pieces are in a stalemated position.
-    Progressing otherwise.
- Note:
-    This is a helper callback for BoardCheckmated function.
+    Int32. As BoardSEE for a PackedMove.
+ Notes:
+    The capture, en passant and promotion flags MovePack cannot
+    derive are read off the board before the exchange is worked out.
  */
-GameResult BoardIsKingCheckmatedEx(Pieces* A, Pieces* B)
+Int32 BoardSEE(Board* Board, Move Move)
 {
-    bool checkResult = PiecesIsKingInCheck(A, B);
-    GameResult gameResult = Unknown;
+    UInt64     startIndex = LeastSigBitIndex(Move.StartSquare);
+    UInt64     endIndex   = LeastSigBitIndex(Move.EndSquare);
+    UInt64     color      = MailboxColor(Board->Mailbox[startIndex]);
+    Pieces*    B          = (color == WHITE_PIECE) ? &Board->Black : &Board->White;
+    UInt64     flags      = MOVE_QUIET;
     
-    if (checkResult == true)
+    if (Board->Mailbox[endIndex] != NONE)
     {
-        gameResult = Checkmated;
+        flags = MOVE_CAPTURE;
     }
-    else
+    else if (MailboxType(Board->Mailbox[startIndex]) == PAWN && B->State.EnPassant == Move.EndSquare)
     {
-        gameResult = Progressing;
+        flags = MOVE_EN_PASSANT;
+    }
+    if (Move.Promotion != NONE)
+    {
+        flags |= MOVE_PROMOTION | (Move.Promotion - MOVE_PROMOTION_PIECE_BASE);
     }
     
-    return gameResult;
+    return BoardSEE(Board, MoveMake(startIndex, endIndex, flags));
 }
 
 /*
@@ -797,51 +1983,33 @@ GameResult BoardIsKingCheckmatedEx(Pieces* A, Pieces* B)
     bool - True if A has checkmated B, false
     otherwise.
  Note:
-    This function is fairly expensive.
-    Avoid calling it frequently.
  */
 bool BoardCheckmated(Pieces* A, Pieces* B)
 {
+    Board    board;
+    MoveList moveList;
+    Pieces*  attacker, *defender;
+    
+    // A and B may have been set by hand, so work on a
+    // board whose occupancy is rebuilt from them
+    BoardInitWithPieces(&board, A, B);
+    attacker = (A->Color == WHITE_PIECE) ? &board.White : &board.Black;
+    defender = (A->Color == WHITE_PIECE) ? &board.Black : &board.White;
+    
     // Quick check to see if B king is in check
     // before continuing with analysis
-    if (PiecesIsKingInCheck(B, A) == false)
+    if (PiecesIsKingInCheck(defender, attacker) == false)
     {
         return false;
     }
     
-    return BoardGameStatus(A, B, BoardIsKingCheckmatedEx);
-}
-
-/*
- Function: BoardIsKingStalematedEx
- Parameters:
-    - Pieces* A. Pieces for attacking side
-    - Pieces* B. Pieces for attacked side
- Return:
-    GameResult - Stalemated if current pieces are in a stalemated position.
-                 Progressing otherwise.
- Note:
-    This is a helper callback for BoardStalemated function.
- */
-GameResult BoardIsKingStalematedEx(Pieces* A, Pieces* B)
-{
-    bool checkResult = PiecesIsKingInCheck(A, B);
-    GameResult gameResult = Unknown;
-    
-    if (checkResult == true)
-    {
-        gameResult = Stalemated;
-    }
-    else
-    {
-        gameResult = Progressing;
-    }
+    BoardGenerateLegalMoves(&board, B->Color, &moveList);
     
-    return gameResult;
+    return (moveList.Count == 0);
 }
 
 /*
- Function: BoardStalemate
+ Function: BoardStalemated
  Parameters:
     - Pieces* A. Pieces for attacking side
     - Pieces* B. Pieces for attacked side
@@ -849,17 +2017,30 @@ GameResult BoardIsKingStalematedEx(Pieces* A, Pieces* B)
     bool - True if A has stalemated B, false
     otherwise.
  Note:
+    Repetition draws are not detected within this function.
  */
 bool BoardStalemated(Pieces* A, Pieces* B)
 {
+    Board    board;
+    MoveList moveList;
+    Pieces*  attacker, *defender;
+    
+    // A and B may have been set by hand, so work on a
+    // board whose occupancy is rebuilt from them
+    BoardInitWithPieces(&board, A, B);
+    attacker = (A->Color == WHITE_PIECE) ? &board.White : &board.Black;
+    defender = (A->Color == WHITE_PIECE) ? &board.Black : &board.White;
+    
     // Quick check to see if current king is in check
     // If so, stalemate is not possible.
-    if (PiecesIsKingInCheck(B, A) == true)
+    if (PiecesIsKingInCheck(defender, attacker) == true)
     {
         return false;
     }
     
-    return BoardGameStatus(A, B, BoardIsKingStalematedEx);
+    BoardGenerateLegalMoves(&board, B->Color, &moveList);
+    
+    return (moveList.Count == 0);
 }
 
 /*
@@ -926,81 +2107,23 @@ bool BoardIsMaterialDraw(Pieces* A, Pieces* B)
     - Board* board. Board object
  Return:
  Notes:
-    This function prints out the board to stdio
+    This function prints out the board to stdio from the mailbox
  */
 void BoardPrint(Board* board)
 {
-    Pieces  white, black;
+    // Indexed by mailbox entry, white pieces first
+    const char* symbols = ".PNBRQK..pnbrqk";
+    UInt8       entry;
     
-    white = board->White;
-    black = board->Black;
-    
-    UInt64 rank = 8;
-    UInt64 rankIndex = 0x100000000000000;
-    UInt64 square;
-    for (UInt64 i = 0; i < 8; i++)
+    for (UInt64 rank = 8; rank > 0; rank--)
     {
         cout << BLUE << rank << " " << WHITE;
-        rank--;
         
-        square = rankIndex;
-        for (UInt64 j = 0; j < 8; j++, square<<=1)
+        for (UInt64 file = 0; file < 8; file++)
         {
-            //DebugPrint(str(square));
-            if (white.Pawns & square)
-            {
-                cout << "P ";
-            }
-            else if (white.Knights & square)
-            {
-                cout << "N ";
-            }
-            else if (white.Bishops & square)
-            {
-                cout << "B ";
-            }
-            else if (white.Rooks & square)
-            {
-                cout << "R ";
-            }
-            else if (white.Queen & square)
-            {
-                cout << "Q ";
-            }
-            else if (white.King & square)
-            {
-                cout << "K ";
-            }
-            else if (black.Pawns & square)
-            {
-                cout << "p ";
-            }
-            else if (black.Knights & square)
-            {
-                cout << "n ";
-            }
-            else if (black.Bishops & square)
-            {
-                cout << "b ";
-            }
-            else if (black.Rooks & square)
-            {
-                cout << "r ";
-            }
-            else if (black.Queen & square)
-            {
-                cout << "q ";
-            }
-            else if (black.King & square)
-            {
-                cout << "k ";
-            }
-            else
-            {
-                cout << ". ";
-            }
+            entry = board->Mailbox[(rank - 1) * 8 + file];
+            cout << symbols[entry] << " ";
         }
-        rankIndex >>= 8;
         cout << endl;
     }
     cout << BLUE << "  A B C D E F G H" << WHITE << endl;
@@ -7,27 +7,115 @@
 #define WHITE_SQUARES 0x55AA55AA55AA55AA
 #define BLACK_SQUARES 0xAA55AA55AA55AA55
 
+#define MAX_MOVES 256
+#define MAX_PLY   1024
+
+// Game plies BoardAttemptMove keeps on History, as many as the 50 move
+// rule lets repeat. A search adds its own plies on top, within MAX_PLY.
+#define BOARD_HISTORY_MAX 100
+
+// The kinds of move BoardGenerateMovesEx can be asked for
+#define BOARD_GENERATE_CAPTURES 0x1 // Captures, en passant and promotions
+#define BOARD_GENERATE_QUIETS   0x2 // Every other move
+
+// Longest FEN BoardToFEN writes, with its null
+#define BOARD_FEN_MAX 128
+
+// BoardScore.Phase with every piece but the pawns and kings on the board
+#define BOARD_PHASE_MAX 24
+
+/*
+ Mailbox entries pack a PieceType in bits 0-2 and the piece's color
+ in bit 3. An empty square holds NONE (0).
+ */
+#define MailboxPiece(type, color) ((UInt8)((type) | ((color) << 3)))
+#define MailboxType(entry)        ((PieceType)((entry) & 0x7))
+#define MailboxColor(entry)       ((UInt64)((entry) >> 3))
+
+/*
+ BoardScore is the material and piece-square balance of a position,
+ in centipawns from White's side, once as it counts in the
+ middlegame and once as it counts in the endgame. Phase says how
+ far towards the middlegame to blend the two.
+ */
+struct BoardScore {
+    Int32 Middlegame;
+    Int32 Endgame;
+    Int32 Phase; // Knights and bishops count 1, rooks 2, queens 4
+};
+
+/*
+ BoardUndo is what BoardUnmakeMove needs to take a move back.
+ Both sides' PlayingState are kept so castle flags and en passant
+ squares come back unchanged, and the hashes, halfmove clock and
+ score are restored rather than recomputed.
+ */
+struct BoardUndo {
+    PackedMove   Move;
+    UInt8        Color;
+    UInt8        Moved;    // PieceType of the moving piece
+    UInt8        Captured; // PieceType taken, NONE otherwise
+    PlayingState WhiteState;
+    PlayingState BlackState;
+    UInt64       Hash;
+    UInt64       PawnHash;
+    UInt64       HalfmoveClock;
+    BoardScore   Score;
+};
+
 struct Board {
-    Pieces White;
-    Pieces Black;
+    Pieces    White;
+    Pieces    Black;
+    UInt8     Mailbox[64]; // Piece on each square, indexed a1 = 0
+    UInt64    Occupancy;   // Every occupied square, both colors
+    UInt64    SideToMove;  // WHITE_PIECE or BLACK_PIECE
+    UInt64    Hash;        // Zobrist key, see BoardComputeHash
+    UInt64    PawnHash;    // Zobrist key of the pawns alone, see BoardComputePawnHash
+    BoardScore Score;      // See BoardComputeScore
+    UInt64    HalfmoveClock;  // Plies since the last capture or pawn move
+    UInt64    FullmoveNumber; // Starts at 1, counts up after Black moves
+    UInt64    Ply; // Number of moves on History
+    BoardUndo History[MAX_PLY];
+};
+
+struct MoveList {
+    PackedMove Moves[MAX_MOVES];
+    UInt64     Count;
 };
 
 enum GameResult {
     Progressing,
     Checkmated,
     Stalemated,
-    Draw = Stalemated,
+    Draw,
     Unknown,
 };
 
+extern const Int32 BoardPieceValues[PIECE_MAX];
+
 void BoardInit(Board*);
 void BoardZeroInit(Board* board);
+void BoardRefresh(Board*);
+bool BoardFromFEN(Board*, const char*);
+UInt64 BoardToFEN(Board*, char*);
+UInt64 BoardComputeHash(Board*);
+UInt64 BoardComputePawnHash(Board*);
+BoardScore BoardComputeScore(Board*);
 bool BoardAttemptMove(Board*, Move, UInt64, bool);
+void BoardMakeMove(Board*, UInt64, PackedMove);
+void BoardUnmakeMove(Board*);
+void BoardGenerateLegalMoves(Board*, UInt64, MoveList*);
+void BoardGenerateCaptures(Board*, UInt64, MoveList*);
+void BoardGenerateQuiets(Board*, UInt64, MoveList*);
+bool BoardIsMoveLegal(Board*, UInt64, PackedMove);
+Int32 BoardSEE(Board*, PackedMove);
+Int32 BoardSEE(Board*, Move);
 bool BoardCheckmated(Pieces* A, Pieces* B);
 bool BoardStalemated(Pieces* A, Pieces* B);
 bool BoardIsMaterialDraw(Pieces* A, Pieces* B);
 
 void BoardPrint(Board* board);
+bool BoardComparePieces(Pieces* A, Pieces* B);
 bool BoardCompare(Board* A, Board* B);
 
 #endif // BOARD_HPP
@@ -14,38 +14,6 @@ inline UInt64 Mirror(UInt64 x)
     return x;
 }
 
-UInt64 BitCount(UInt64 x)
-{
-    UInt64 lsbb   = 0x1111111111111111;
-    
-    UInt64 mask   = 0xF0F;
-    UInt64 count  = 0;
-    UInt64 sum, usum, lsum = 0;
-    
-    if (x == 0)
-    {
-        return 0;
-    }
-    
-    sum  = lsbb & x;
-    sum += lsbb & (x >> 1);
-    sum += lsbb & (x >> 2);
-    sum += lsbb & (x >> 3);
-    
-    lsum = (sum >> 32);
-    usum = (sum << 32) >> 32;
-    
-    lsum   = lsum + (lsum >> 16);
-    lsum   = ((lsum & mask) + (mask & (lsum >> 4)));
-    count  = (((lsum >> 8) + lsum) & 0x3F);
-    
-    usum   = usum + (usum >> 16);
-    usum   = ((usum & mask) + (mask & (usum >> 4)));
-    count += (((usum >> 8) + usum) & 0x3F);
-    
-    return count;
-}
-
 void DebugBoard(UInt64 board)
 {
     board = Flip(board);
@@ -64,3 +32,27 @@ void DebugBoard(UInt64 board)
     cout << BLUE << "  A B C D E F G H" << WHITE << endl;
 }
 
+/*
+ Function: MoveToString
+ Parameters:
+    - PackedMove Move. A move
+ Return:
+    string. The move in coordinate notation, e.g. e2e4 or e7e8q.
+ Notes:
+ */
+string MoveToString(PackedMove Move)
+{
+    string text = "";
+    
+    text += (char)('a' + (MoveStartIndex(Move) & 0x7));
+    text += (char)('1' + (MoveStartIndex(Move) >> 3));
+    text += (char)('a' + (MoveEndIndex(Move) & 0x7));
+    text += (char)('1' + (MoveEndIndex(Move) >> 3));
+    
+    if (MoveIsPromotion(Move))
+    {
+        text += "nbrq"[MoveFlags(Move) & 0x3];
+    }
+    
+    return text;
+}
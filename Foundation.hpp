@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <cstdint>
+#include <cstring>
+#include <cstddef>
 using namespace std;
 
 typedef int8_t   Int8;
@@ -117,9 +119,7 @@ extern UInt64 File[8];
                        pieces->Bishops | \
                        pieces->Rooks   | \
                        pieces->Queen   | \
-                       pieces->King    | \
-                       pieces->Reserved| \
-                       pieces->Reserved2)\
+                       pieces->King)\
 
 #define LeastSigBit(X) ((X) & (~(X) + 1))
 
@@ -133,13 +133,262 @@ extern UInt64 File[8];
 #define YELLOW  "\e[1;33m"
 #define WHITE   "\e[0m"
 
+/*
+ Bit primitives. On GCC and Clang these map to POPCNT, TZCNT/BSF and
+ LZCNT/BSR. Other compilers get the portable constexpr fallbacks.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define FOUNDATION_HAS_BUILTINS 1
+#else
+#define FOUNDATION_HAS_BUILTINS 0
+#endif
+
+/*
+ Function: BitCount
+ Parameters:
+    - UInt64 x. A board
+ Return:
+    UInt64. The number of set squares on the board.
+ Notes:
+ */
+inline constexpr UInt64 BitCount(UInt64 x)
+{
+#if FOUNDATION_HAS_BUILTINS
+    return (UInt64)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555);
+    x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0F;
+    return (x * 0x0101010101010101) >> 56;
+#endif
+}
+
+/*
+ Function: LeastSigBitIndex
+ Parameters:
+    - UInt64 x. A non-empty board
+ Return:
+    UInt64. The square index (0 = a1, 63 = h8) of the lowest set square.
+ Notes:
+    The result is undefined when x is 0.
+ */
+inline constexpr UInt64 LeastSigBitIndex(UInt64 x)
+{
+#if FOUNDATION_HAS_BUILTINS
+    return (UInt64)__builtin_ctzll(x);
+#else
+    return BitCount(LeastSigBit(x) - 1);
+#endif
+}
+
+/*
+ Function: MostSigBitIndex
+ Parameters:
+    - UInt64 x. A non-empty board
+ Return:
+    UInt64. The square index (0 = a1, 63 = h8) of the highest set square.
+ Notes:
+    The result is undefined when x is 0.
+ */
+inline constexpr UInt64 MostSigBitIndex(UInt64 x)
+{
+#if FOUNDATION_HAS_BUILTINS
+    return (UInt64)(63 ^ __builtin_clzll(x));
+#else
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    x |= x >> 32;
+    return BitCount(x) - 1;
+#endif
+}
+
+/*
+ Function: MostSigBit
+ Parameters:
+    - UInt64 x. A board
+ Return:
+    UInt64. The highest set square of the board, 0 if it is empty.
+ Notes:
+ */
+inline constexpr UInt64 MostSigBit(UInt64 x)
+{
+    return (x == 0) ? 0 : (0x1ULL << MostSigBitIndex(x));
+}
+
+/*
+ Function: PopLeastSigBit
+ Parameters:
+    - UInt64* x. A non-empty board
+ Return:
+    UInt64. The square index of the lowest set square, which is
+    also cleared from x.
+ Notes:
+    x & (x - 1) is emitted as a single BLSR when BMI is enabled.
+    This is the standard way to serialise a board into its squares:
+        while (board) { index = PopLeastSigBit(&board); ... }
+ */
+inline constexpr UInt64 PopLeastSigBit(UInt64* x)
+{
+    UInt64 index = LeastSigBitIndex(*x);
+    *x &= (*x - 1);
+    return index;
+}
+
+/*
+ Function: FillNorth
+ Parameters:
+    - UInt64 x. A board
+ Return:
+    UInt64. Every set square and all the squares above it on its file.
+ Notes:
+    FillNorth(x << 8) is everything in front of White's pawns on x.
+ */
+inline constexpr UInt64 FillNorth(UInt64 x)
+{
+    x |= x << 8;
+    x |= x << 16;
+    x |= x << 32;
+    return x;
+}
+
+/*
+ Function: FillSouth
+ Parameters:
+    - UInt64 x. A board
+ Return:
+    UInt64. Every set square and all the squares below it on its file.
+ Notes:
+ */
+inline constexpr UInt64 FillSouth(UInt64 x)
+{
+    x |= x >> 8;
+    x |= x >> 16;
+    x |= x >> 32;
+    return x;
+}
+
 struct Move {
     UInt64 StartSquare;
     UInt64 EndSquare;
+    UInt8  Promotion = 0; // PieceType the pawn promotes to, NONE otherwise
 };
 
+/*
+ PackedMove is the 16 bit form of a move used by move lists and tables.
+    Bits 0-5  : Start square index (0 = a1, 63 = h8)
+    Bits 6-11 : End square index
+    Bits 12-15: Flags
+ Flags 0x8 and up are promotions, the low two bits selecting
+ knight, bishop, rook or queen. 0x4 is set on every capture.
+ */
+typedef UInt16 PackedMove;
+
+#define MOVE_NONE             0x0
+#define MOVE_QUIET            0x0
+#define MOVE_DOUBLE_PUSH      0x1
+#define MOVE_KING_CASTLE      0x2
+#define MOVE_QUEEN_CASTLE     0x3
+#define MOVE_CAPTURE          0x4
+#define MOVE_EN_PASSANT       0x5
+#define MOVE_PROMOTION        0x8
+#define MOVE_PROMOTION_KNIGHT 0x8
+#define MOVE_PROMOTION_BISHOP 0x9
+#define MOVE_PROMOTION_ROOK   0xA
+#define MOVE_PROMOTION_QUEEN  0xB
+
+// The PieceType values of knight through queen are contiguous from 2
+#define MOVE_PROMOTION_PIECE_BASE 2
+
+inline constexpr PackedMove MoveMake(UInt64 StartIndex, UInt64 EndIndex, UInt64 Flags)
+{
+    return (PackedMove)(StartIndex | (EndIndex << 6) | (Flags << 12));
+}
+
+inline constexpr UInt64 MoveStartIndex(PackedMove M)
+{
+    return M & 0x3F;
+}
+
+inline constexpr UInt64 MoveEndIndex(PackedMove M)
+{
+    return (M >> 6) & 0x3F;
+}
+
+inline constexpr UInt64 MoveFlags(PackedMove M)
+{
+    return M >> 12;
+}
+
+inline constexpr bool MoveIsCapture(PackedMove M)
+{
+    return (MoveFlags(M) & MOVE_CAPTURE) != 0;
+}
+
+inline constexpr bool MoveIsPromotion(PackedMove M)
+{
+    return (MoveFlags(M) & MOVE_PROMOTION) != 0;
+}
+
+/*
+ Function: MovePromotionPiece
+ Parameters:
+    - PackedMove M. A move
+ Return:
+    UInt8. The PieceType the move promotes to, NONE (0) otherwise.
+ Notes:
+ */
+inline constexpr UInt8 MovePromotionPiece(PackedMove M)
+{
+    return MoveIsPromotion(M) ? (UInt8)((MoveFlags(M) & 0x3) + MOVE_PROMOTION_PIECE_BASE) : 0;
+}
+
+/*
+ Function: MoveUnpack
+ Parameters:
+    - PackedMove M. A move
+ Return:
+    Move. The same move as start/end squares and a promotion piece.
+ Notes:
+ */
+inline Move MoveUnpack(PackedMove M)
+{
+    Move move;
+    
+    move.StartSquare = 0x1ULL << MoveStartIndex(M);
+    move.EndSquare   = 0x1ULL << MoveEndIndex(M);
+    move.Promotion   = MovePromotionPiece(M);
+    
+    return move;
+}
+
+/*
+ Function: MovePack
+ Parameters:
+    - Move M. A move with single-square start and end squares
+ Return:
+    PackedMove. The move in 16 bits.
+ Notes:
+    Only the promotion flag can be derived from the struct alone.
+    Capture, castle, en passant and double push flags need the board,
+    so match input against a generated list by squares and promotion.
+ */
+inline PackedMove MovePack(Move M)
+{
+    UInt64 flags = MOVE_QUIET;
+    
+    if (M.Promotion != 0)
+    {
+        flags = MOVE_PROMOTION | (M.Promotion - MOVE_PROMOTION_PIECE_BASE);
+    }
+    
+    return MoveMake(LeastSigBitIndex(M.StartSquare), LeastSigBitIndex(M.EndSquare), flags);
+}
+
 UInt64 FlipBoard(UInt64 board);
-UInt64 BitCount(UInt64);
 void DebugBoard(UInt64);
+string MoveToString(PackedMove);
 
 #endif // FOUNDATION_HPP
@@ -1,4 +1,13 @@
 #include "Game.hpp"
+#include "Search.hpp"
+#include "Transposition.hpp"
+#include <thread>
+
+// Passed as the computer's color when both sides are played at the console
+#define GAME_NO_COMPUTER 2
+
+// How long the computer thinks about each move, in milliseconds
+#define GAME_COMPUTER_TIME 2000
 
 void GamePrintInfo(string message)
 {
@@ -115,11 +124,53 @@ GameResult GameGetGameResult(Board* board, UInt64 Color)
         goto End;
     }
     
+    // 50 moves by each side without a capture or pawn move
+    if (board->HalfmoveClock >= 100)
+    {
+        gameResult = Draw;
+        goto End;
+    }
+    
 End:
     return gameResult;
 }
 
-void GamePlayAlone()
+/*
+ Function: GameComputerMove
+ Parameters:
+    - Board* board. The position to move from
+    - UInt64 Color. The side the computer plays
+    - Move* Move. Receives the move chosen
+ Return:
+ Notes:
+    Prints the move, its score and the line the computer expects.
+    The search uses every hardware thread.
+ */
+void GameComputerMove(Board* board, UInt64 Color, Move* Move)
+{
+    SearchLimits limits = {0, 0, GAME_COMPUTER_TIME, thread::hardware_concurrency()};
+    SearchResult result = SearchBestMove(board, Color, limits);
+    string message = "Computer plays " + MoveToString(result.BestMove) +
+                     " (depth " + to_string(result.Depth) + ", score " + to_string(result.Score) + ", pv";
+    
+    for (UInt64 i = 0; i < result.PVLength; i++)
+    {
+        message += " " + MoveToString(result.PV[i]);
+    }
+    GamePrintInfo(message + ")\n");
+    
+    *Move = MoveUnpack(result.BestMove);
+}
+
+/*
+ Function: GamePlay
+ Parameters:
+    - UInt64 ComputerColor. The side the computer plays, or
+      GAME_NO_COMPUTER for two players at the console
+ Return:
+ Notes:
+ */
+void GamePlay(UInt64 ComputerColor)
 {
     string userInput;
     string startSquare, endSquare, winner;
@@ -128,6 +179,7 @@ void GamePlayAlone()
     
     Board board;
     BoardInit(&board);
+    TranspositionClear();
     GameResult gameResult = Progressing;
     bool isMoveLegal = false;
     
@@ -144,6 +196,15 @@ void GamePlayAlone()
         }
         
         BoardPrint(&board);
+        if (color == ComputerColor)
+        {
+            GameComputerMove(&board, color, &move);
+            BoardAttemptMove(&board, move, color, true);
+            gameResult = GameGetGameResult(&board, color);
+            color ^= 1;
+            continue;
+        }
+        
         cout << "Start Square: ";
         getline(cin, startSquare);
         cout << "End Square  : ";
@@ -191,7 +252,18 @@ void GamePlayAlone()
             GamePrintInfo(winner);
             break;
         case Stalemated:
-            GamePrintInfo("Draw!");
+            GamePrintInfo("Draw!\n");
+            break;
+        case Draw:
+            if (board.HalfmoveClock >= 100)
+            {
+                GamePrintInfo("Draw by the 50-move rule!\n");
+            }
+            else
+            {
+                GamePrintInfo("Draw by insufficient material!\n");
+            }
+            break;
         default:
             GamePrintError("Unknown game result.\n");
             break;
@@ -207,11 +279,19 @@ void StartMenu()
     
     while (userInput != "E")
     {
-        GamePrintInfo("Play Alone (A), Exit (E): ");
+        GamePrintInfo("Play Alone (A), Play Computer as White (W) or Black (B), Exit (E): ");
         getline(cin, userInput);
         if (userInput == "A")
         {
-            GamePlayAlone();
+            GamePlay(GAME_NO_COMPUTER);
+        }
+        else if (userInput == "W")
+        {
+            GamePlay(BLACK_PIECE);
+        }
+        else if (userInput == "B")
+        {
+            GamePlay(WHITE_PIECE);
         }
     }
 }
@@ -3,6 +3,7 @@
 
 #include "Board.hpp"
 
+GameResult GameGetGameResult(Board*, UInt64);
 void StartMenu();
 
 #endif
@@ -1,9 +1,24 @@
 #include "Foundation.hpp"
 #include "Board.hpp"
 #include "Game.hpp"
+#include "Perft.hpp"
+#include "Search.hpp"
+#include "Transposition.hpp"
 
 Int32 main(Int32 argc, char** argv)
 {
+    PiecesInit();
+    
+    if (argc > 1 && string(argv[1]) == "perft")
+    {
+        return PerftMain(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "search")
+    {
+        return SearchMain(argc - 2, argv + 2);
+    }
+    
+    TranspositionInit(TRANSPOSITION_DEFAULT_MB);
     StartMenu();
     return 0;
 }
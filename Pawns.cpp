@@ -0,0 +1,194 @@
+#include "Pawns.hpp"
+
+// Pawn structure terms, middlegame then endgame
+#define PAWNS_DOUBLED_MG   -10 // For each pawn with another of its side in front of it
+#define PAWNS_DOUBLED_EG   -20
+#define PAWNS_ISOLATED_MG   -5 // No pawn of its side on either next file
+#define PAWNS_ISOLATED_EG  -15
+#define PAWNS_BACKWARD_MG   -8 // Its stop square is attacked by a pawn and can't be defended by one
+#define PAWNS_BACKWARD_EG  -10
+#define PAWNS_SHIELD_NEAR   10 // A pawn on or beside its king's file, one rank ahead of it
+#define PAWNS_SHIELD_FAR     5 // ...or two ranks ahead
+
+// Passed pawn bonus by rank, counted from the pawn's own side
+const Int32 PawnsPassedMiddlegame[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+const Int32 PawnsPassedEndgame[8]    = {0, 10, 20, 35, 60, 100, 150, 0};
+
+/*
+ Function: PawnsEastEx
+ Parameters:
+    - UInt64 Squares
+ Return:
+    UInt64. Squares moved one file towards h, dropping the h file.
+ Notes:
+ */
+inline UInt64 PawnsEastEx(UInt64 Squares)
+{
+    return (Squares << 1) & ~FILE_A;
+}
+
+/*
+ Function: PawnsWestEx
+ Parameters:
+    - UInt64 Squares
+ Return:
+    UInt64. Squares moved one file towards a, dropping the a file.
+ Notes:
+ */
+inline UInt64 PawnsWestEx(UInt64 Squares)
+{
+    return (Squares >> 1) & ~FILE_H;
+}
+
+/*
+ Function: PawnsSideEx
+ Parameters:
+    - UInt64 Own. The pawns of the side being scored
+    - UInt64 Enemy. The other side's pawns
+    - Int32* Middlegame. Receives the side's middlegame score
+    - Int32* Endgame. Receives the side's endgame score
+ Return:
+    UInt64. The side's passed pawns.
+ Notes:
+    The side is scored as if it were White, moving up the board.
+    Black's pawns are flipped before they are passed in, and its
+    passed pawns flipped back after.
+ */
+UInt64 PawnsSideEx(UInt64 Own, UInt64 Enemy, Int32* Middlegame, Int32* Endgame)
+{
+    UInt64 enemyFront   = FillSouth(Enemy >> 8);
+    UInt64 enemyAttacks = PawnsWestEx(Enemy >> 8) | PawnsEastEx(Enemy >> 8);
+    UInt64 ownAttacks   = PawnsWestEx(Own << 8) | PawnsEastEx(Own << 8);
+    UInt64 ownFiles     = FillNorth(FillSouth(Own));
+    UInt64 doubled, isolated, backward, passed, pawns;
+    UInt64 rank;
+    
+    doubled  = Own & FillSouth(Own >> 8);
+    isolated = Own & ~(PawnsWestEx(ownFiles) | PawnsEastEx(ownFiles));
+    backward = Own & ~isolated & ((enemyAttacks & ~FillNorth(ownAttacks)) >> 8);
+    passed   = Own & ~doubled & ~(enemyFront | PawnsWestEx(enemyFront) | PawnsEastEx(enemyFront));
+    
+    *Middlegame = (Int32)BitCount(doubled)  * PAWNS_DOUBLED_MG +
+                  (Int32)BitCount(isolated) * PAWNS_ISOLATED_MG +
+                  (Int32)BitCount(backward) * PAWNS_BACKWARD_MG;
+    *Endgame    = (Int32)BitCount(doubled)  * PAWNS_DOUBLED_EG +
+                  (Int32)BitCount(isolated) * PAWNS_ISOLATED_EG +
+                  (Int32)BitCount(backward) * PAWNS_BACKWARD_EG;
+    
+    pawns = passed;
+    while (pawns != 0)
+    {
+        rank = PopLeastSigBit(&pawns) >> 3;
+        *Middlegame += PawnsPassedMiddlegame[rank];
+        *Endgame    += PawnsPassedEndgame[rank];
+    }
+    
+    return passed;
+}
+
+/*
+ Function: PawnsShieldEx
+ Parameters:
+    - UInt64 Own. The pawns of the king's side
+    - UInt64 King. The king
+ Return:
+    Int32. The middlegame bonus for the pawns sheltering King.
+ Notes:
+    Scored as if King were White's, like PawnsSideEx. The shield only
+    counts for a king still on its first two ranks.
+ */
+Int32 PawnsShieldEx(UInt64 Own, UInt64 King)
+{
+    UInt64 kingFiles = King | PawnsWestEx(King) | PawnsEastEx(King);
+    
+    if ((King & (RANK_1 | RANK_2)) == 0)
+    {
+        return 0;
+    }
+    
+    return (Int32)BitCount(Own & (kingFiles << 8))  * PAWNS_SHIELD_NEAR +
+           (Int32)BitCount(Own & (kingFiles << 16)) * PAWNS_SHIELD_FAR;
+}
+
+/*
+ Function: PawnsUpdateShieldsEx
+ Parameters:
+    - Board* Board. The position scored
+    - PawnsEntry* Entry. An entry holding Board's pawn structure
+ Return:
+ Notes:
+    Works out the shield again for each king that is not on the
+    square its shield was worked out for.
+ */
+void PawnsUpdateShieldsEx(Board* Board, PawnsEntry* Entry)
+{
+    if (Entry->Kings[WHITE_PIECE] != Board->White.King)
+    {
+        Entry->Kings[WHITE_PIECE]  = Board->White.King;
+        Entry->Shield[WHITE_PIECE] = PawnsShieldEx(Board->White.Pawns, Board->White.King);
+    }
+    if (Entry->Kings[BLACK_PIECE] != Board->Black.King)
+    {
+        Entry->Kings[BLACK_PIECE]  = Board->Black.King;
+        Entry->Shield[BLACK_PIECE] = PawnsShieldEx(Flip(Board->Black.Pawns), Flip(Board->Black.King));
+    }
+}
+
+/*
+ Function: PawnsEvaluate
+ Parameters:
+    - Board* Board. The position to score
+    - PawnsEntry* Entry. Receives the pawn structure of Board
+ Return:
+ Notes:
+    Computes the entry from scratch, with a handful of file and rank
+    fills over the pawn bit boards rather than a loop over pawns.
+    Black is scored on a flipped board, so it moves up it too.
+ */
+void PawnsEvaluate(Board* Board, PawnsEntry* Entry)
+{
+    Int32 whiteMiddlegame, whiteEndgame, blackMiddlegame, blackEndgame;
+    UInt64 blackPassed;
+    
+    Entry->Key = Board->PawnHash;
+    Entry->Passed[WHITE_PIECE] = PawnsSideEx(Board->White.Pawns, Board->Black.Pawns, &whiteMiddlegame, &whiteEndgame);
+    blackPassed = PawnsSideEx(Flip(Board->Black.Pawns), Flip(Board->White.Pawns), &blackMiddlegame, &blackEndgame);
+    Entry->Passed[BLACK_PIECE] = Flip(blackPassed);
+    Entry->Middlegame = whiteMiddlegame - blackMiddlegame;
+    Entry->Endgame    = whiteEndgame - blackEndgame;
+    
+    // No king stands on every square, so both shields are worked out
+    Entry->Kings[WHITE_PIECE] = ~0ULL;
+    Entry->Kings[BLACK_PIECE] = ~0ULL;
+    PawnsUpdateShieldsEx(Board, Entry);
+}
+
+/*
+ Function: PawnsProbe
+ Parameters:
+    - PawnsTable* Table. The searching thread's table
+    - Board* Board. The position to score
+ Return:
+    PawnsEntry*. The pawn structure of Board, from the table if it
+    was there and computed and stored otherwise, with the shields of
+    both kings where they now stand.
+ Notes:
+    The whole 64 bit key is compared, so a hit is never another
+    position's entry in practice. Pawn structures change far less
+    often than the rest of the position, so most probes hit.
+ */
+PawnsEntry* PawnsProbe(PawnsTable* Table, Board* Board)
+{
+    PawnsEntry* entry = &Table->Entries[Board->PawnHash & (PAWNS_TABLE_SIZE - 1)];
+    
+    if (entry->Key != Board->PawnHash)
+    {
+        PawnsEvaluate(Board, entry);
+    }
+    else
+    {
+        PawnsUpdateShieldsEx(Board, entry);
+    }
+    
+    return entry;
+}
@@ -0,0 +1,37 @@
+#ifndef PAWNS_HPP
+#define PAWNS_HPP
+
+#include "Board.hpp"
+
+#define PAWNS_TABLE_SIZE 16384 // Entries in one thread's table, a power of two
+
+/*
+ PawnsEntry is the pawn structure of one position: the doubled,
+ isolated, backward and passed pawn terms, in centipawns from White's
+ side. They depend only on where the pawns are, so one entry serves
+ every position with the same Board->PawnHash. Each king's pawn
+ shield is kept too, along with the king square it was worked out
+ for, and is only worked out again once that king moves.
+ */
+struct PawnsEntry {
+    UInt64 Key;        // Board->PawnHash, 0 while the entry is empty
+    UInt64 Passed[2];  // Each color's passed pawns
+    Int32  Middlegame;
+    Int32  Endgame;
+    UInt64 Kings[2];   // The king squares Shield is for
+    Int32  Shield[2];  // Middlegame bonus for the pawns in front of each king
+};
+
+/*
+ A PawnsTable belongs to one search thread, so it is read and
+ written without atomics. An entry is replaced by any other
+ position that hashes to it.
+ */
+struct PawnsTable {
+    PawnsEntry Entries[PAWNS_TABLE_SIZE];
+};
+
+void PawnsEvaluate(Board*, PawnsEntry*);
+PawnsEntry* PawnsProbe(PawnsTable*, Board*);
+
+#endif // PAWNS_HPP
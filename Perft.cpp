@@ -0,0 +1,354 @@
+#include "Perft.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*
+ A PerftTask is one subtree of a parallel perft: the moves leading
+ to it from the root, and the leaf count found below it.
+ */
+struct PerftTask {
+    PackedMove Moves[2];
+    UInt64     MoveCount;
+    UInt64     Nodes;
+};
+
+/*
+ A PerftEntry caches the leaf count below one position. Data packs
+ the depth in bits 0-7 and the node count above them; Check holds
+ the position's hash XOR Data. Threads read and write the two words
+ without locks, and an entry torn by a concurrent write fails the
+ XOR check and is treated as a miss, so results never change.
+ */
+struct PerftEntry {
+    atomic<UInt64> Check;
+    atomic<UInt64> Data;
+};
+
+PerftEntry* PerftTable     = NULL;
+UInt64      PerftTableMask = 0;
+
+/*
+ Function: PerftTableInit
+ Parameters:
+    - UInt64 MegaBytes. The table size, 0 to turn the table off
+ Return:
+    bool. True if the table was allocated or turned off, false if
+    the memory could not be allocated.
+ Notes:
+    The entry count is rounded down to a power of two.
+ */
+bool PerftTableInit(UInt64 MegaBytes)
+{
+    UInt64 entries = (MegaBytes << 20) / sizeof(PerftEntry);
+    
+    delete[] PerftTable;
+    PerftTable     = NULL;
+    PerftTableMask = 0;
+    
+    if (entries == 0)
+    {
+        return true;
+    }
+    
+    entries    = MostSigBit(entries);
+    PerftTable = new (nothrow) PerftEntry[entries];
+    if (PerftTable == NULL)
+    {
+        return false;
+    }
+    
+    for (UInt64 i = 0; i < entries; i++)
+    {
+        PerftTable[i].Check.store(0, memory_order_relaxed);
+        PerftTable[i].Data.store(0, memory_order_relaxed);
+    }
+    PerftTableMask = entries - 1;
+    
+    return true;
+}
+
+/*
+ Function: PerftCount
+ Parameters:
+    - Board* Board. The position to count from
+    - UInt64 Depth. The number of plies to search
+ Return:
+    UInt64. The number of leaf positions Depth plies below Board.
+ Notes:
+    Leaves are bulk counted: at depth 1 the size of the legal move
+    list is the answer, so the last ply is never made. Above that,
+    counts are looked up in and stored to the perft table when one
+    has been set up with PerftTableInit.
+ */
+UInt64 PerftCount(Board* Board, UInt64 Depth)
+{
+    MoveList    moveList;
+    PerftEntry* entry = NULL;
+    UInt64      nodes = 0;
+    UInt64      data;
+    
+    if (Depth == 0)
+    {
+        return 1;
+    }
+    
+    if (PerftTable != NULL && Depth > 1)
+    {
+        entry = &PerftTable[Board->Hash & PerftTableMask];
+        data  = entry->Data.load(memory_order_relaxed);
+        if ((entry->Check.load(memory_order_relaxed) ^ data) == Board->Hash &&
+            (data & 0xFF) == Depth)
+        {
+            return data >> 8;
+        }
+    }
+    
+    BoardGenerateLegalMoves(Board, Board->SideToMove, &moveList);
+    if (Depth == 1)
+    {
+        return moveList.Count;
+    }
+    
+    for (UInt64 i = 0; i < moveList.Count; i++)
+    {
+        BoardMakeMove(Board, Board->SideToMove, moveList.Moves[i]);
+        nodes += PerftCount(Board, Depth - 1);
+        BoardUnmakeMove(Board);
+    }
+    
+    if (entry != NULL)
+    {
+        data = (nodes << 8) | Depth;
+        entry->Check.store(Board->Hash ^ data, memory_order_relaxed);
+        entry->Data.store(data, memory_order_relaxed);
+    }
+    
+    return nodes;
+}
+
+/*
+ Function: PerftDivide
+ Parameters:
+    - Board* Board. The position to count from
+    - UInt64 Depth. The number of plies to search, at least 1
+ Return:
+    UInt64. The number of leaf positions Depth plies below Board.
+ Notes:
+    Prints the leaf count below each root move, which is what is
+    compared against a reference engine to find a generator bug.
+ */
+UInt64 PerftDivide(Board* Board, UInt64 Depth)
+{
+    MoveList moveList;
+    UInt64   nodes, total = 0;
+    
+    BoardGenerateLegalMoves(Board, Board->SideToMove, &moveList);
+    for (UInt64 i = 0; i < moveList.Count; i++)
+    {
+        BoardMakeMove(Board, Board->SideToMove, moveList.Moves[i]);
+        nodes = PerftCount(Board, Depth - 1);
+        BoardUnmakeMove(Board);
+        
+        cout << MoveToString(moveList.Moves[i]) << ": " << nodes << endl;
+        total += nodes;
+    }
+    
+    return total;
+}
+
+/*
+ Function: PerftWorkerEx
+ Parameters:
+    - Board* Root. The root position, only read
+    - UInt64 Depth. The perft depth from the root
+    - vector<PerftTask>* Tasks. The subtrees to count
+    - atomic<UInt64>* Next. The index of the next unclaimed task
+ Return:
+ Notes:
+    Each worker plays on its own copy of the board and claims tasks
+    until none are left, so a thread that drew small subtrees keeps
+    taking work from the shared pool while others finish large ones.
+    The only shared write is the claim counter; each task's count is
+    written by the one thread that claimed it.
+ */
+void PerftWorkerEx(Board* Root, UInt64 Depth, vector<PerftTask>* Tasks, atomic<UInt64>* Next)
+{
+    Board*     board = new Board;
+    PerftTask* task;
+    UInt64     index;
+    
+    memcpy(board, Root, offsetof(Board, History) + Root->Ply * sizeof(BoardUndo));
+    
+    while ((index = Next->fetch_add(1, memory_order_relaxed)) < Tasks->size())
+    {
+        task = &(*Tasks)[index];
+        for (UInt64 i = 0; i < task->MoveCount; i++)
+        {
+            BoardMakeMove(board, board->SideToMove, task->Moves[i]);
+        }
+        
+        task->Nodes = PerftCount(board, Depth - task->MoveCount);
+        
+        for (UInt64 i = 0; i < task->MoveCount; i++)
+        {
+            BoardUnmakeMove(board);
+        }
+    }
+    
+    delete board;
+}
+
+/*
+ Function: PerftCountParallel
+ Parameters:
+    - Board* Board. The position to count from
+    - UInt64 Depth. The number of plies to search
+    - UInt64 Threads. The number of threads to count with
+ Return:
+    UInt64. The number of leaf positions Depth plies below Board,
+    the same as PerftCount.
+ Notes:
+    The tree is split two plies below the root, which gives several
+    hundred subtrees in a typical middlegame, and hands each subtree
+    to whichever thread is free next.
+ */
+UInt64 PerftCountParallel(Board* Board, UInt64 Depth, UInt64 Threads)
+{
+    vector<PerftTask> tasks;
+    vector<thread>    workers;
+    atomic<UInt64>    next(0);
+    MoveList rootMoves, replies;
+    UInt64   nodes = 0;
+    
+    if (Threads <= 1 || Depth < 3)
+    {
+        return PerftCount(Board, Depth);
+    }
+    
+    BoardGenerateLegalMoves(Board, Board->SideToMove, &rootMoves);
+    for (UInt64 i = 0; i < rootMoves.Count; i++)
+    {
+        BoardMakeMove(Board, Board->SideToMove, rootMoves.Moves[i]);
+        BoardGenerateLegalMoves(Board, Board->SideToMove, &replies);
+        for (UInt64 j = 0; j < replies.Count; j++)
+        {
+            tasks.push_back({{rootMoves.Moves[i], replies.Moves[j]}, 2, 0});
+        }
+        BoardUnmakeMove(Board);
+    }
+    
+    for (UInt64 i = 0; i < Threads; i++)
+    {
+        workers.emplace_back(PerftWorkerEx, Board, Depth, &tasks, &next);
+    }
+    for (UInt64 i = 0; i < Threads; i++)
+    {
+        workers[i].join();
+    }
+    
+    for (UInt64 i = 0; i < tasks.size(); i++)
+    {
+        nodes += tasks[i].Nodes;
+    }
+    
+    return nodes;
+}
+
+/*
+ Function: PerftMain
+ Parameters:
+    - Int32 argc. The number of arguments after "perft"
+    - char** argv. The arguments after "perft"
+ Return:
+    Int32. The process exit code.
+ Notes:
+    Usage: Chess perft <depth> [divide] [threads <n>] [hash <mb>] [fen "<fen>"]
+    Counts from the FEN position, or the start position without one,
+    printing the node count, the time taken and nodes per second for
+    every depth from 1 to <depth>, or the per-move breakdown at
+    <depth> when divide is given. Counting
+    uses <n> threads, one by default; divide is always single threaded.
+    A <mb> megabyte table shared by all threads caches subtree counts.
+ */
+Int32 PerftMain(Int32 argc, char** argv)
+{
+    static Board board;
+    UInt64 depth, nodes;
+    UInt64 threads = 1;
+    UInt64 hashSize = 0;
+    const char* fen = NULL;
+    bool   isDivide = false;
+    double seconds;
+    Int32  exitCode = 0;
+    chrono::steady_clock::time_point start;
+    
+    if (argc < 1 || atoi(argv[0]) < 1)
+    {
+        cout << RED << "Error" << WHITE << ": Usage: perft <depth> [divide] [threads <n>] [hash <mb>] [fen \"<fen>\"]" << endl;
+        exitCode = 1;
+        goto End;
+    }
+    
+    depth = atoi(argv[0]);
+    for (Int32 i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "divide")
+        {
+            isDivide = true;
+        }
+        else if (string(argv[i]) == "threads" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "hash" && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+        {
+            hashSize = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "fen" && i + 1 < argc)
+        {
+            fen = argv[++i];
+        }
+        else
+        {
+            cout << RED << "Error" << WHITE << ": Unknown perft option " << argv[i] << endl;
+            exitCode = 1;
+            goto End;
+        }
+    }
+    
+    if (fen == NULL)
+    {
+        BoardInit(&board);
+    }
+    else if (BoardFromFEN(&board, fen) == false)
+    {
+        cout << RED << "Error" << WHITE << ": Invalid FEN " << fen << endl;
+        exitCode = 1;
+        goto End;
+    }
+    
+    if (PerftTableInit(hashSize) == false)
+    {
+        cout << RED << "Error" << WHITE << ": Cannot allocate a " << hashSize << "MB perft table" << endl;
+        exitCode = 1;
+        goto End;
+    }
+    
+    for (UInt64 d = (isDivide ? depth : 1); d <= depth; d++)
+    {
+        start   = chrono::steady_clock::now();
+        nodes   = isDivide ? PerftDivide(&board, d) : PerftCountParallel(&board, d, threads);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        
+        cout << "perft " << d << ": " << nodes << " nodes, "
+             << seconds << "s, "
+             << (UInt64)(nodes / (seconds > 0 ? seconds : 1e-9)) << " nps" << endl;
+    }
+    
+    PerftTableInit(0);
+    
+End:
+    return exitCode;
+}
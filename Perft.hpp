@@ -0,0 +1,12 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+#include "Board.hpp"
+
+bool PerftTableInit(UInt64);
+UInt64 PerftCount(Board*, UInt64);
+UInt64 PerftCountParallel(Board*, UInt64, UInt64);
+UInt64 PerftDivide(Board*, UInt64);
+Int32 PerftMain(Int32, char**);
+
+#endif // PERFT_HPP
@@ -1,81 +1,571 @@
 #include "Pieces.hpp"
 
-#define ColEx(X) (((RANK_8 & X) >> 56) | \
-                    ((RANK_7 & X) >> 48) | \
-                    ((RANK_6 & X) >> 40) | \
-                    ((RANK_5 & X) >> 32) | \
-                    ((RANK_4 & X) >> 24) | \
-                    ((RANK_3 & X) >> 16) | \
-                    ((RANK_2 & X) >> 8)  | \
-                    ((RANK_1 & X)))        \
+struct Magic {
+    UInt64  Mask;
+    UInt64  Magic;
+    UInt64* Attacks;
+    UInt32  Shift;
+};
 
-#define minz(X,Y) ((X < Y && X != 0 ? X : (Y != 0 ? Y : X)))
-#define min(X,Y) (X < Y ? X : Y)
-#define max(X,Y) (X > Y ? X : Y)
+Magic  RookMagics[64];
+Magic  BishopMagics[64];
+bool   PiecesUsePext = false;
+UInt64 RookAttackTable[0x19000];
+UInt64 BishopAttackTable[0x1480];
+UInt64 BetweenTable[64][64];
+UInt64 LineTable[64][64];
 
 /*
- Function: MostSigBit
+ Function: PiecesPextEx
  Parameters:
-    - UInt64 value. A value which represents the board.
+    - UInt64 Value. The bits to gather
+    - UInt64 Mask. The positions to gather them from
  Return:
-    UInt64. The most significant bit.
+    UInt64. The bits of Value selected by Mask, packed into the low bits.
  Notes:
+    Emits the BMI2 PEXT instruction directly so the rest of this file can
+    be built for baseline x86-64. It must only be reached when
+    PiecesUsePext is set.
  */
-UInt64 MostSigBit(UInt64 value)
+inline UInt64 PiecesPextEx(UInt64 Value, UInt64 Mask)
 {
-    UInt64 msb = 0x8000000000000000;
-    if (value == 0)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    UInt64 result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(Value), "r"(Mask));
+    return result;
+#else
+    return 0;
+#endif
+}
+
+/*
+ Function: PiecesPdepEx
+ Parameters:
+    - UInt64 Value. The packed bits to scatter
+    - UInt64 Mask. The positions to scatter them to
+ Return:
+    UInt64. The low bits of Value deposited onto the set bits of Mask.
+ Notes:
+    The inverse of PiecesPextEx. Used to enumerate the occupancy subsets
+    in the order the PEXT index expects.
+ */
+inline UInt64 PiecesPdepEx(UInt64 Value, UInt64 Mask)
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    UInt64 result;
+    __asm__("pdepq %2, %1, %0" : "=r"(result) : "r"(Value), "r"(Mask));
+    return result;
+#else
+    return 0;
+#endif
+}
+
+/*
+ Function: PiecesCpuHasPextEx
+ Parameters:
+ Return:
+    bool. True if the running CPU supports the BMI2 instructions.
+ Notes:
+ */
+bool PiecesCpuHasPextEx()
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+/*
+ Function: PiecesSliderIndexEx
+ Parameters:
+    - Magic* M. The slider entry of the square
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The offset of the attack set inside M->Attacks.
+ Notes:
+    The branch is fixed for the whole run, so it is always predicted.
+ */
+inline UInt64 PiecesSliderIndexEx(Magic* M, UInt64 Occupancy)
+{
+    if (PiecesUsePext)
     {
-        return 0;
+        return PiecesPextEx(Occupancy, M->Mask);
     }
+    return ((Occupancy & M->Mask) * M->Magic) >> M->Shift;
+}
+
+/*
+ Function: PiecesSlidingAttacksEx
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the slider
+    - UInt64 Occupancy. Every occupied square on the board
+    - const Int32 Directions[4][2]. The (rank, file) steps of the slider
+ Return:
+    UInt64. The squares attacked from Index, including the first
+    blocker found along every direction.
+ Notes:
+    This is the slow reference walk used to fill the magic tables.
+    It is only called from PiecesInitMagicsEx.
+ */
+UInt64 PiecesSlidingAttacksEx(UInt64 Index, UInt64 Occupancy, const Int32 Directions[4][2])
+{
+    UInt64 attacks = 0;
+    UInt64 square;
+    Int32  row, col;
     
-    while ((msb & value) == 0)
+    for (UInt64 i = 0; i < 4; i++)
     {
-        msb >>= 1;
+        row = (Int32)(Index / 8) + Directions[i][0];
+        col = (Int32)(Index % 8) + Directions[i][1];
+        while (row >= 0 && row < 8 && col >= 0 && col < 8)
+        {
+            square   = 0x1ULL << (row * 8 + col);
+            attacks |= square;
+            if (Occupancy & square)
+            {
+                break;
+            }
+            row += Directions[i][0];
+            col += Directions[i][1];
+        }
     }
-    return msb;
+    
+    return attacks;
 }
 
 /*
- Function: RowIndex
+ Function: PiecesRandomEx
  Parameters:
-    - UInt64 piece. A piece on a board
+    - UInt64* State. The generator state, must be non-zero
  Return:
-    UInt64. The row/Rank of where the piece is located.
+    UInt64. A pseudo random number with roughly 1/8 of its bits set.
  Notes:
-    This function assumes there's only one piece on the board.
-    The return value is 0th index.
+    xorshift64* generator. Sparse numbers make much better magic
+    candidates, so three draws are and-ed together.
  */
-inline UInt64 RowIndex(UInt64 piece)
+UInt64 PiecesRandomEx(UInt64* State)
 {
-    UInt64 row = 0;
-    for (row = 0; row < 8; row++)
+    UInt64 value = ~0ULL;
+    
+    for (UInt64 i = 0; i < 3; i++)
     {
-        if ((piece & (0xFFULL << (row*8))) != 0)
+        *State ^= *State >> 12;
+        *State ^= *State << 25;
+        *State ^= *State >> 27;
+        value  &= *State * 2685821657736338717ULL;
+    }
+    
+    return value;
+}
+
+/*
+ Function: PiecesInitMagicsEx
+ Parameters:
+    - Magic Magics[64]. The magic entries to fill in
+    - UInt64* Table. The shared attack table for the piece type
+    - const Int32 Directions[4][2]. The (rank, file) steps of the slider
+ Return:
+ Notes:
+    For every square, enumerates all subsets of the relevant occupancy
+    mask (Carry-Rippler) and searches a magic number that maps each of
+    them to a slot holding the right attack set. The seeds are chosen
+    per rank so that the search finishes in a few milliseconds.
+    When PiecesUsePext is set, the subsets are instead laid out by their
+    PEXT index and no magic search is needed.
+ */
+void PiecesInitMagicsEx(Magic Magics[64], UInt64* Table, const Int32 Directions[4][2])
+{
+    const UInt64 seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    
+    UInt64 occupancy[4096], reference[4096];
+    UInt32 epoch[4096] = {0};
+    UInt32 attempt = 0;
+    UInt64 edges, index, state;
+    UInt64 size = 0;
+    UInt64 i;
+    Magic* m;
+    
+    for (UInt64 square = 0; square < 64; square++)
+    {
+        m = &Magics[square];
+        
+        // Board edges are not relevant unless the slider sits on them
+        edges = ((RANK_1 | RANK_8) & ~Rank[square / 8]) |
+                ((FILE_A | FILE_H) & ~File[square % 8]);
+        
+        m->Mask    = PiecesSlidingAttacksEx(square, 0, Directions) & ~edges;
+        m->Shift   = (UInt32)(64 - BitCount(m->Mask));
+        m->Attacks = (square == 0) ? Table : Magics[square - 1].Attacks + size;
+        
+        if (PiecesUsePext)
+        {
+            // The PEXT of a subset is its rank in the PDEP enumeration
+            size = 0x1ULL << (64 - m->Shift);
+            for (i = 0; i < size; i++)
+            {
+                m->Attacks[i] = PiecesSlidingAttacksEx(square, PiecesPdepEx(i, m->Mask), Directions);
+            }
+            continue;
+        }
+        
+        // Enumerate every subset of the mask and record its attacks
+        size  = 0;
+        index = 0;
+        do
+        {
+            occupancy[size] = index;
+            reference[size] = PiecesSlidingAttacksEx(square, index, Directions);
+            size++;
+            index = (index - m->Mask) & m->Mask;
+        } while (index != 0);
+        
+        state = seeds[square / 8];
+        for (i = 0; i < size; )
         {
-            break;
+            do
+            {
+                m->Magic = PiecesRandomEx(&state);
+            } while (BitCount((m->Magic * m->Mask) >> 56) < 6);
+            
+            // Check the candidate maps every subset without a destructive
+            // collision. The epoch avoids clearing the table between tries.
+            attempt++;
+            for (i = 0; i < size; i++)
+            {
+                index = ((occupancy[i] & m->Mask) * m->Magic) >> m->Shift;
+                if (epoch[index] < attempt)
+                {
+                    epoch[index]      = attempt;
+                    m->Attacks[index] = reference[i];
+                }
+                else if (m->Attacks[index] != reference[i])
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/*
+ Function: PiecesInitLinesEx
+ Parameters:
+ Return:
+ Notes:
+    Fills the between and line tables from the empty board slider
+    attacks. Must run after the slider tables are built.
+ */
+void PiecesInitLinesEx()
+{
+    UInt64 aBit, bBit;
+    
+    for (UInt64 a = 0; a < 64; a++)
+    {
+        for (UInt64 b = 0; b < 64; b++)
+        {
+            aBit = 0x1ULL << a;
+            bBit = 0x1ULL << b;
+            
+            if (a == b)
+            {
+                continue;
+            }
+            
+            if (PiecesRookAttacks(a, 0) & bBit)
+            {
+                LineTable[a][b]    = (PiecesRookAttacks(a, 0) & PiecesRookAttacks(b, 0)) | aBit | bBit;
+                BetweenTable[a][b] = PiecesRookAttacks(a, bBit) & PiecesRookAttacks(b, aBit);
+            }
+            else if (PiecesBishopAttacks(a, 0) & bBit)
+            {
+                LineTable[a][b]    = (PiecesBishopAttacks(a, 0) & PiecesBishopAttacks(b, 0)) | aBit | bBit;
+                BetweenTable[a][b] = PiecesBishopAttacks(a, bBit) & PiecesBishopAttacks(b, aBit);
+            }
         }
     }
-    return row;
 }
 
 /*
- Function: ColIndex
+ Function: PiecesInitSliders
+ Parameters:
+    - bool UsePext. True to index the tables with PEXT, false for magics
+ Return:
+    bool. True if the tables were built, false if PEXT was asked for
+    but the running CPU does not support it.
+ Notes:
+    Rebuilds the sliding piece attack, between and line tables for the
+    given backend. PiecesInit picks the backend from the CPU, tests call
+    this directly to check both backends on the same machine.
+ */
+bool PiecesInitSliders(bool UsePext)
+{
+    const Int32 rookDirections[4][2]   = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    const Int32 bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    
+    if (UsePext && PiecesCpuHasPextEx() == false)
+    {
+        return false;
+    }
+    
+    PiecesUsePext = UsePext;
+    
+    PiecesInitMagicsEx(RookMagics, RookAttackTable, rookDirections);
+    PiecesInitMagicsEx(BishopMagics, BishopAttackTable, bishopDirections);
+    PiecesInitLinesEx();
+    return true;
+}
+
+/*
+ Function: PiecesInit
+ Parameters:
+ Return:
+ Notes:
+    Builds the sliding piece attack tables. This must be called once at
+    startup, before any of the Pieces*Move functions are used.
+    CPUs with BMI2 index the tables with PEXT, all others use magics.
+ */
+void PiecesInit()
+{
+    PiecesInitSliders(PiecesCpuHasPextEx());
+}
+
+/*
+ Function: PiecesRookAttacks
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the rook
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The squares the rook attacks, including the first blocker
+    in every direction regardless of its color.
+ Notes:
+ */
+UInt64 PiecesRookAttacks(UInt64 Index, UInt64 Occupancy)
+{
+    Magic* m = &RookMagics[Index];
+    return m->Attacks[PiecesSliderIndexEx(m, Occupancy)];
+}
+
+/*
+ Function: PiecesBishopAttacks
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the bishop
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The squares the bishop attacks, including the first blocker
+    in every direction regardless of its color.
+ Notes:
+ */
+UInt64 PiecesBishopAttacks(UInt64 Index, UInt64 Occupancy)
+{
+    Magic* m = &BishopMagics[Index];
+    return m->Attacks[PiecesSliderIndexEx(m, Occupancy)];
+}
+
+/*
+ Function: PiecesQueenAttacks
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the queen
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The squares the queen attacks.
+ Notes:
+ */
+UInt64 PiecesQueenAttacks(UInt64 Index, UInt64 Occupancy)
+{
+    return PiecesRookAttacks(Index, Occupancy) | PiecesBishopAttacks(Index, Occupancy);
+}
+
+/*
+ Function: PiecesBetween
+ Parameters:
+    - UInt64 A. A square index (0 = a1, 63 = h8)
+    - UInt64 B. A square index (0 = a1, 63 = h8)
+ Return:
+    UInt64. The squares strictly between A and B when they share a
+    rank, file or diagonal, 0 otherwise.
+ Notes:
+ */
+UInt64 PiecesBetween(UInt64 A, UInt64 B)
+{
+    return BetweenTable[A][B];
+}
+
+/*
+ Function: PiecesLine
+ Parameters:
+    - UInt64 A. A square index (0 = a1, 63 = h8)
+    - UInt64 B. A square index (0 = a1, 63 = h8)
+ Return:
+    UInt64. The whole rank, file or diagonal through A and B,
+    0 if they are not aligned.
+ Notes:
+ */
+UInt64 PiecesLine(UInt64 A, UInt64 B)
+{
+    return LineTable[A][B];
+}
+
+struct AttackTable {
+    UInt64 Squares[64];
+};
+
+/*
+ Function: PiecesLeaperTableEx
+ Parameters:
+    - const Int32 Steps[][2]. The (rank, file) jumps of the piece
+    - UInt64 Count. The number of jumps in Steps
+ Return:
+    AttackTable. The attacked squares from each of the 64 squares.
+ Notes:
+    Evaluated at compile time for the knight, king and pawn tables.
+ */
+constexpr AttackTable PiecesLeaperTableEx(const Int32 Steps[][2], UInt64 Count)
+{
+    AttackTable table = {};
+    Int32 row = 0, col = 0;
+    
+    for (Int32 square = 0; square < 64; square++)
+    {
+        for (UInt64 i = 0; i < Count; i++)
+        {
+            row = square / 8 + Steps[i][0];
+            col = square % 8 + Steps[i][1];
+            if (row >= 0 && row < 8 && col >= 0 && col < 8)
+            {
+                table.Squares[square] |= 0x1ULL << (row * 8 + col);
+            }
+        }
+    }
+    
+    return table;
+}
+
+constexpr Int32 KnightSteps[8][2]    = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1},
+                                        {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+constexpr Int32 KingSteps[8][2]      = {{1, 0}, {-1, 0}, {0, 1}, {0, -1},
+                                        {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+constexpr Int32 WhitePawnSteps[2][2] = {{1, 1}, {1, -1}};
+constexpr Int32 BlackPawnSteps[2][2] = {{-1, 1}, {-1, -1}};
+
+constexpr AttackTable KnightAttackTable  = PiecesLeaperTableEx(KnightSteps, 8);
+constexpr AttackTable KingAttackTable    = PiecesLeaperTableEx(KingSteps, 8);
+constexpr AttackTable PawnAttackTable[2] = {PiecesLeaperTableEx(WhitePawnSteps, 2),
+                                            PiecesLeaperTableEx(BlackPawnSteps, 2)};
+
+/*
+ Function: PiecesKnightAttacks
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the knight
+ Return:
+    UInt64. The squares a knight on Index attacks.
+ Notes:
+ */
+UInt64 PiecesKnightAttacks(UInt64 Index)
+{
+    return KnightAttackTable.Squares[Index];
+}
+
+/*
+ Function: PiecesKingAttacks
+ Parameters:
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the king
+ Return:
+    UInt64. The squares a king on Index attacks.
+ Notes:
+ */
+UInt64 PiecesKingAttacks(UInt64 Index)
+{
+    return KingAttackTable.Squares[Index];
+}
+
+/*
+ Function: PiecesPawnAttacks
+ Parameters:
+    - UInt64 Color. The color of the pawn
+    - UInt64 Index. The square index (0 = a1, 63 = h8) of the pawn
+ Return:
+    UInt64. The two (or one, on the edge files) diagonal squares
+    a pawn of Color on Index attacks.
+ Notes:
+ */
+UInt64 PiecesPawnAttacks(UInt64 Color, UInt64 Index)
+{
+    return PawnAttackTable[Color].Squares[Index];
+}
+
+/*
+ Function: PiecesAttackersTo
+ Parameters:
+    - Pieces* A. The attacking side
+    - UInt64 Index. The square index (0 = a1, 63 = h8) being attacked
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    UInt64. The pieces of A that attack Index.
+ Notes:
+    Works backwards from the target: a piece attacks Index exactly when
+    the same piece standing on Index would attack it. Pawns use the
+    table of the opposite color for that reason.
+ */
+UInt64 PiecesAttackersTo(Pieces* A, UInt64 Index, UInt64 Occupancy)
+{
+    return (PawnAttackTable[A->Color ^ 1].Squares[Index] & A->Pawns) |
+           (KnightAttackTable.Squares[Index] & A->Knights) |
+           (KingAttackTable.Squares[Index] & A->King) |
+           (PiecesBishopAttacks(Index, Occupancy) & (A->Bishops | A->Queen)) |
+           (PiecesRookAttacks(Index, Occupancy) & (A->Rooks | A->Queen));
+}
+
+/*
+ Function: PiecesIsSquareAttacked
+ Parameters:
+    - Pieces* A. The attacking side
+    - UInt64 Index. The square index (0 = a1, 63 = h8) being attacked
+    - UInt64 Occupancy. Every occupied square on the board
+ Return:
+    bool. True if any piece of A attacks Index.
+ Notes:
+    Same as PiecesAttackersTo, but returns on the first attacker found
+    and skips the slider lookups when A has no sliders of that kind.
+ */
+bool PiecesIsSquareAttacked(Pieces* A, UInt64 Index, UInt64 Occupancy)
+{
+    if ((PawnAttackTable[A->Color ^ 1].Squares[Index] & A->Pawns) ||
+        (KnightAttackTable.Squares[Index] & A->Knights) ||
+        (KingAttackTable.Squares[Index] & A->King))
+    {
+        return true;
+    }
+    
+    if ((A->Bishops | A->Queen) &&
+        (PiecesBishopAttacks(Index, Occupancy) & (A->Bishops | A->Queen)))
+    {
+        return true;
+    }
+    
+    if ((A->Rooks | A->Queen) &&
+        (PiecesRookAttacks(Index, Occupancy) & (A->Rooks | A->Queen)))
+    {
+        return true;
+    }
+    
+    return false;
+}
+
+/*
+ Function: PiecesRefreshOccupancy
  Parameters:
-    - UInt64 piece. A piece on a board
+    - Pieces* A. The side whose pieces were set by hand
  Return:
-    UInt64. The column/File of where the piece is located.
  Notes:
-    This function assumes there's only one piece on the board.
-    The return value is 0th index.
+    The move functions read A->Occupancy rather than rebuilding the
+    union of A's bit boards on every call. BoardMakeMove keeps it up
+    to date; call this after setting A's bit boards directly.
  */
-inline UInt64 ColIndex(UInt64 piece)
+void PiecesRefreshOccupancy(Pieces* A)
 {
-    UInt64 bit = ColEx(piece);
-    UInt64 col = 0;
-    while (bit >>= 1)
-        col++;
-    return col;
+    A->Occupancy = Union(A);
 }
 
 /*
@@ -132,7 +622,7 @@ UInt64 PiecesPawnAttack(Pieces* A, Pieces* B)
         return 0;
     }
     
-    bPLocation = Union(B);
+    bPLocation = B->Occupancy;
     
     if (A->Color == WHITE_PIECE)
     {
@@ -164,10 +654,9 @@ UInt64 PiecesWhitePawnMove(Pieces* A, Pieces* B)
     UInt64 firstMove;
     UInt64 forward;
     UInt64 aPLocation, bPLocation;
-    UInt64 enPassantSquares, enPassantEscapeSquare;
     
-    aPLocation = Union(A);
-    bPLocation = Union(B);
+    aPLocation = A->Occupancy;
+    bPLocation = B->Occupancy;
     
     attacks = PiecesPawnAttack(A, B);
     
@@ -184,23 +673,8 @@ UInt64 PiecesWhitePawnMove(Pieces* A, Pieces* B)
     
     aMoves = forward | firstMove | attacks;
     
-    // Check for En Passants
-    // The following checks
-    // - If Black's last moved piece is a pawn, and
-    // - There exist a white pawn on the 5th rank, and
-    // - Black's pawn moved two squares on its first move
-    if (B->State.LastMovedPiece == PAWN &&
-        (A->Pawns & RANK_5) &&
-        (B->State.LastMove.StartSquare & RANK_7) &&
-        (B->State.LastMove.EndSquare   & RANK_5))
-    {
-        enPassantSquares  = Intersect(A->Pawns << 7, FILE_H);
-        enPassantSquares |= Intersect(A->Pawns << 9, FILE_A);
-        enPassantEscapeSquare = B->State.LastMove.EndSquare << 8;
-        
-        enPassantSquares &= enPassantEscapeSquare;
-        aMoves |= enPassantSquares;
-    }
+    // En passant onto the square Black's double push skipped
+    aMoves |= PiecesPawnMoveFast(A, B) & B->State.EnPassant;
     
     return aMoves;
 }
@@ -221,10 +695,9 @@ UInt64 PiecesBlackPawnMove(Pieces* A, Pieces* B)
     UInt64 firstMove;
     UInt64 forward;
     UInt64 aPLocation, bPLocation;
-    UInt64 enPassantSquares, enPassantEscapeSquare;
     
-    aPLocation = Union(A);
-    bPLocation = Union(B);
+    aPLocation = A->Occupancy;
+    bPLocation = B->Occupancy;
 
     attacks = PiecesPawnAttack(A, B);
     
@@ -241,49 +714,8 @@ UInt64 PiecesBlackPawnMove(Pieces* A, Pieces* B)
     
     aMoves = forward | firstMove | attacks;
     
-    // Check for En Passants
-    // The following checks
-    // - If White's last moved piece is a pawn, and
-    // - There exist a black pawn on the 4th rank, and
-    // - White's pawn moved two squares on its first move
-    if (B->State.LastMovedPiece == PAWN &&
-        (A->Pawns & RANK_4) &&
-        (B->State.LastMove.StartSquare & RANK_2) &&
-        (B->State.LastMove.EndSquare   & RANK_4))
-    {
-        enPassantSquares  = Intersect(A->Pawns >> 7, FILE_A);
-        enPassantSquares |= Intersect(A->Pawns >> 9, FILE_H);
-        enPassantEscapeSquare = B->State.LastMove.EndSquare >> 8;
-        
-        enPassantSquares &= enPassantEscapeSquare;
-        aMoves |= enPassantSquares;
-    }
-    
-    return aMoves;
-}
-
-/*
- Function: PiecesPawnMoveEx
- Parameters:
-    - Pieces* A. The moving side pieces
-    - Pieces* B. The non-moving side pieces
- Return:
-    UInt64. The squares where the pawns can go.
- Notes:
-    This function assumes there's only one pawn on the board.
- */
-UInt64 PiecesPawnMoveEx(Pieces* A, Pieces* B)
-{
-    UInt64 aMoves = 0;
-    
-    if (A->Color == WHITE_PIECE)
-    {
-        aMoves = PiecesWhitePawnMove(A, B);
-    }
-    else
-    {
-        aMoves = PiecesBlackPawnMove(A, B);
-    }
+    // En passant onto the square White's double push skipped
+    aMoves |= PiecesPawnMoveFast(A, B) & B->State.EnPassant;
     
     return aMoves;
 }
@@ -294,42 +726,28 @@ UInt64 PiecesPawnMoveEx(Pieces* A, Pieces* B)
     - Pieces A. The moving side pieces
     - Pieces B. The non-moving side pieces
  Return:
-    UInt64. The squares where the bishop can go.
+    UInt64. The squares where the pawns can go.
  Notes:
- 
+    Pushes, double pushes, captures and en passant are all computed
+    set-wise, so every pawn is handled at once without serialising.
  */
 UInt64 PiecesPawnMove(Pieces* A, Pieces* B)
 {
-    Pieces movingSide;
-    UInt64 aMoves;
-    
-    UInt64 pawn   = A->Pawns;
-    UInt64 square  = 0x1;
-    aMoves = 0;
+    UInt64 aMoves = 0;
     
     // Special case when there are no pawns on the board
-    if (pawn == 0)
+    if (A->Pawns == 0)
     {
         return 0;
     }
     
-    memcpy(&movingSide, A, sizeof(Pieces));
-    // There may be more than one pawn. Iterate the board
-    // and calculate the moves for each pawn.
-    for (UInt64 i = 0; i < 64; i++, square <<= 1)
+    if (A->Color == WHITE_PIECE)
     {
-        if (pawn & square)
-        {
-            // Found a pawn. Move all other pawns to reserved,
-            // so it doesn't interfere with the pawns move calculation
-            movingSide.Pawns     = square;
-            movingSide.Reserved  = pawn & ~square;
-            aMoves |= PiecesPawnMoveEx(&movingSide, B);
-            
-            movingSide.Pawns      = pawn;
-            movingSide.Reserved   = 0;
-        }
-        
+        aMoves = PiecesWhitePawnMove(A, B);
+    }
+    else
+    {
+        aMoves = PiecesBlackPawnMove(A, B);
     }
     
     return aMoves;
@@ -347,7 +765,7 @@ UInt64 PiecesPawnMove(Pieces* A, Pieces* B)
 UInt64 PiecesKnightMove(Pieces* A, Pieces* B)
 {
     UInt64 aMoves;
-    UInt64 aPLocation = Union(A);
+    UInt64 aPLocation = A->Occupancy;
     UInt64 knights = A->Knights;
     
     if (knights == 0)
@@ -367,259 +785,55 @@ UInt64 PiecesKnightMove(Pieces* A, Pieces* B)
     return aMoves;
 }
 
-/*
- Function: PiecesBishopMoveEx
- Parameters:
-    - Pieces A. The moving side pieces
-    - Pieces B. The non-moving side pieces
- Return:
-    UInt64. The squares where the bishop can go.
- Notes:
-    This is an private function under the assumption
-    that there's only one bishop.
- */
-UInt64 PiecesBishopMoveEx(Pieces* A, Pieces* B)
-{
-    UInt64 aMoves;
-    UInt64 aPLocation, bPLocation;
-    UInt64 row, col, square;
-    UInt64 bishopRow, bishopCol;
-    
-    bishopRow = RowIndex(A->Bishops);
-    bishopCol = ColIndex(A->Bishops);
-    
-    aPLocation = Union(A);
-    bPLocation = Union(B);
-    
-    aMoves = 0;
-    
-    // Get the moves going NE
-    for (row = bishopRow, col = bishopCol, square = A->Bishops;
-         row < 7 && col < 7;
-         row++, col++)
-    {
-        square <<= 9;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going NW
-    for (row = bishopRow, col = bishopCol, square = A->Bishops;
-         row < 7 && col > 0;
-         row++, col--)
-    {
-        square <<= 7;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going SW
-    for (row = bishopRow, col = bishopCol, square = A->Bishops;
-         row > 0 && col > 0;
-         row--, col--)
-    {
-        square >>= 9;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going SE
-    for (row = bishopRow, col = bishopCol, square = A->Bishops;
-         row > 0 && col < 7;
-         row--, col++)
-    {
-        square >>= 7;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    return aMoves;
-}
-
 /*
  Function: PiecesBishopMove
  Parameters:
     - Pieces A. The moving side pieces
     - Pieces B. The non-moving side pieces
  Return:
-    UInt64. The squares where the bishop can go.
+    UInt64. The squares where the bishops can go.
  Notes:
-
  */
 UInt64 PiecesBishopMove(Pieces* A, Pieces* B)
 {
-    Pieces movingSide;
     UInt64 aMoves;
-    
-    UInt64 bishop  = A->Bishops;
-    UInt64 square  = 0x1;
-    aMoves = 0;
+    UInt64 aPLocation, occupancy;
+    UInt64 bishops = A->Bishops;
     
     // Special case when there are no bishops on the board
-    if (bishop == 0)
+    if (bishops == 0)
     {
         return 0;
     }
     
-    memcpy(&movingSide, A, sizeof(Pieces));
-    // There may be more than one bishop. Iterate the board
-    // and calculate the moves for each rook.
-    for (UInt64 i = 0; i < 64; i++, square <<= 1)
-    {
-        if (bishop & square)
-        {
-            // Found a rook. Move all other bishops to reserved,
-            // so it doesn't interfere with the bishops move calculation
-            movingSide.Bishops   = square;
-            movingSide.Reserved  = bishop & ~square;
-            aMoves |= PiecesBishopMoveEx(&movingSide, B);
-            
-            movingSide.Bishops    = bishop;
-            movingSide.Reserved   = 0;
-        }
-        
-    }
+    aPLocation = A->Occupancy;
+    occupancy  = aPLocation | B->Occupancy;
+    aMoves     = 0;
     
-    return aMoves;
-}
-
-/*
- Function: PiecesBishopMove
- Parameters:
-    - Pieces A. The moving side pieces
-    - Pieces B. The non-moving side pieces
- Return:
-    UInt64. The squares where the rook can go.
- Notes:
-    This is a private function that assumes
-    there's only one rook.
- */
-UInt64 PiecesRookMoveEx(Pieces* A, Pieces* B)
-{
-    UInt64 aMoves, horizontalMoves, verticalMoves;
-    UInt64 aPLocation;
-    UInt64 bPLocation;
-    UInt64 lsb, msb;
-    UInt64 lmask, umask;
-    
-    UInt64 rookFile;
-    UInt64 rookRank;
-    UInt64 rookRowIndex = RowIndex(A->Rooks);
-    UInt64 rookColIndex = ColIndex(A->Rooks);
-    
-    aPLocation = Union(A);
-    bPLocation = Union(B);
-    rookRank   = Rank[rookRowIndex];
-    rookFile   = File[rookColIndex];
-    lmask      = (A->Rooks-1);
-    umask      = ~(A->Rooks-1) << 1;
-    
-    aPLocation &= (rookRank | rookFile);
-    bPLocation &= (rookRank | rookFile);
-    
-    // First calculate the horizontal rank moves
-    // Find the closest piece east of the rook.
-    // If it's the same color, subtract that square, else
-    // include it in the row.
-    lsb = minz(LeastSigBit(aPLocation & umask & rookRank),
-               LeastSigBit(bPLocation & umask & rookRank));
-
-    if (lsb & bPLocation)
+    // There may be more than one bishop. Look up each bishop
+    // by bit-scanning the occupied squares only.
+    while (bishops != 0)
     {
-        // If the east most piece closest to the rook is the not the
-        // same color, it is attackable, so include it.
-        lsb <<= 1;
+        aMoves |= PiecesBishopAttacks(PopLeastSigBit(&bishops), occupancy);
     }
-    // Fill out the row with legal moves by doing msb - 1.
-    // This will cause all the remaining bits to be 1 due to
-    // msb being a 2^n integer.
-    horizontalMoves = (lsb - 1);
     
-    // Find the west most piece closest to rook
-    msb = max(MostSigBit(aPLocation & lmask & rookRank),
-              MostSigBit(bPLocation & lmask & rookRank));
-    
-    // Now either include or exclude the west most piece depending on color
-    if (msb & aPLocation)
-    {
-        msb <<= 1;
-    }
-    // There can be a case where there are no pieces west of the rook. This will
-    // cause msb = 0 => msb = (UInt64)-1 which will erase everything when Intersected.
-    // Because of this, keep msb = 0.
-    msb = msb != 0 ? msb - 1 : msb;
-
-    horizontalMoves = Intersect(horizontalMoves, msb) & rookRank;
-
-    // Now calculate the vertical moves similar to how the horizontal moves where
-    // calculated
-    lsb = minz(LeastSigBit(aPLocation & umask & rookFile),
-               LeastSigBit(bPLocation & umask & rookFile));
-
-    if (lsb & bPLocation)
-    {
-        lsb <<= 1;
-    }
-    verticalMoves = (lsb - 1);
-    msb = max(MostSigBit(aPLocation & lmask & rookFile),
-              MostSigBit(bPLocation & lmask & rookFile));
-    if (msb & aPLocation)
-    {
-        msb <<= 1;
-    }
-    msb = msb != 0 ? msb - 1 : msb;
-    
-    verticalMoves = Intersect(verticalMoves, msb) & rookFile;
-    
-    aMoves = Intersect(horizontalMoves | verticalMoves, A->Rooks);
-    return aMoves;
+    return Intersect(aMoves, aPLocation);
 }
 
 /*
- Function: PiecesBishopMove
+ Function: PiecesRookMove
  Parameters:
     - Pieces A. The moving side pieces
     - Pieces B. The non-moving side pieces
  Return:
-    UInt64. The squares where the rook can go.
+    UInt64. The squares where the rooks can go.
  Notes:
  */
 UInt64 PiecesRookMove(Pieces* A, Pieces* B)
 {
-    Pieces movingSide;
     UInt64 aMoves;
-    
-    UInt64 rooks  = A->Rooks;
-    UInt64 square = 0x1;
-    aMoves = 0;
+    UInt64 aPLocation, occupancy;
+    UInt64 rooks = A->Rooks;
     
     // Special case when there are no rooks on the board
     if (rooks == 0)
@@ -627,195 +841,18 @@ UInt64 PiecesRookMove(Pieces* A, Pieces* B)
         return 0;
     }
     
-    memcpy(&movingSide, A, sizeof(Pieces));
-    // There may be more than one rook. Iterate the board
-    // and calculate the moves for each rook.
-    for (UInt64 i = 0; i < 64; i++, square <<= 1)
-    {
-        if (rooks & square)
-        {
-            // Found a rook. Move all other rooks to reserved,
-            // so it doesn't interfere with the rook move calculation
-            movingSide.Rooks    = square;
-            movingSide.Reserved = rooks & ~square;
-            aMoves |= PiecesRookMoveEx(&movingSide, B);
-            
-            movingSide.Rooks    = rooks;
-            movingSide.Reserved = 0;
-        }
-        
-    }
-    
-    return aMoves;
-}
-
-/*
- Function: PiecesQueenMove
- Parameters:
-    - Pieces A. The moving side pieces
-    - Pieces B. The non-moving side pieces
- Return:
-    UInt64. The squares where the queen can go.
- Notes:
-    This function combines the logic of the rook and bishop.
-    This is a private function with the assumption
-    there's only one queen.
- */
-UInt64 PiecesQueenMoveEx(Pieces* A, Pieces* B)
-{
-    UInt64 aMoves;
-    UInt64 aPLocation, bPLocation;
-    UInt64 row, col, square;
-    UInt64 queenRow, queenCol;
-    UInt64 horizontalMoves, verticalMoves;
-    UInt64 lsb, msb;
-    UInt64 lmask, umask;
-    
-    UInt64 queenFile;
-    UInt64 queenRank;
-    
-    queenRow = RowIndex(A->Queen);
-    queenCol = ColIndex(A->Queen);
-    
-    aPLocation = Union(A);
-    bPLocation = Union(B);
-    
-    aMoves = 0;
-    
-    // Get the moves going NE
-    for (row = queenRow, col = queenCol, square = A->Queen;
-         row < 7 && col < 7;
-         row++, col++)
-    {
-        square <<= 9;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going NW
-    for (row = queenRow, col = queenCol, square = A->Queen;
-         row < 7 && col > 0;
-         row++, col--)
-    {
-        square <<= 7;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going SW
-    for (row = queenRow, col = queenCol, square = A->Queen;
-         row > 0 && col > 0;
-         row--, col--)
-    {
-        square >>= 9;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    // Get the moves going SE
-    for (row = queenRow, col = queenCol, square = A->Queen;
-         row > 0 && col < 7;
-         row--, col++)
-    {
-        square >>= 7;
-        if (aPLocation & square)
-        {
-            break;
-        }
-        aMoves |= square;
-        if (bPLocation & square)
-        {
-            break;
-        }
-    }
-    
-    queenRank   = Rank[queenRow];
-    queenFile   = File[queenCol];
-    lmask      = (A->Queen-1);
-    umask      = ~(A->Queen-1) << 1;
-    
-    aPLocation &= (queenRank | queenFile);
-    bPLocation &= (queenRank | queenFile);
-    
-    // First calculate the horizontal rank moves
-    // Find the closest piece east of the queen.
-    // If it's the same color, subtract that square, else
-    // include it in the row.
-    lsb = minz(LeastSigBit(aPLocation & umask & queenRank),
-               LeastSigBit(bPLocation & umask & queenRank));
-    
-    if (lsb & bPLocation)
-    {
-        // If the east most piece closest to the queen is the not the
-        // same color, it is attackable, so include it.
-        lsb <<= 1;
-    }
-    // Fill out the row with legal moves by doing msb - 1.
-    // This will cause all the remaining bits to be 1 due to
-    // msb being a 2^n integer.
-    horizontalMoves = (lsb - 1);
-    
-    // Find the west most piece closest to queen
-    msb = max(MostSigBit(aPLocation & lmask & queenRank),
-              MostSigBit(bPLocation & lmask & queenRank));
-    
-    // Now either include or exclude the west most piece depending on color
-    if (msb & aPLocation)
-    {
-        msb <<= 1;
-    }
-    // There can be a case where there are no pieces west of the queen. This will
-    // cause msb = 0 => msb = (UInt64)-1 which will erase everything when Intersected.
-    // Because of this, keep msb = 0.
-    msb = msb != 0 ? msb - 1 : msb;
+    aPLocation = A->Occupancy;
+    occupancy  = aPLocation | B->Occupancy;
+    aMoves     = 0;
     
-    horizontalMoves = Intersect(horizontalMoves, msb) & queenRank;
-    
-    // Now calculate the vertical moves similar to how the horizontal moves where
-    // calculated
-    lsb = minz(LeastSigBit(aPLocation & umask & queenFile),
-               LeastSigBit(bPLocation & umask & queenFile));
-    
-    if (lsb & bPLocation)
-    {
-        lsb <<= 1;
-    }
-    verticalMoves = (lsb - 1);
-    msb = max(MostSigBit(aPLocation & lmask & queenFile),
-              MostSigBit(bPLocation & lmask & queenFile));
-    if (msb & aPLocation)
+    // There may be more than one rook. Look up each rook
+    // by bit-scanning the occupied squares only.
+    while (rooks != 0)
     {
-        msb <<= 1;
+        aMoves |= PiecesRookAttacks(PopLeastSigBit(&rooks), occupancy);
     }
-    msb = msb != 0 ? msb - 1 : msb;
-    
-    verticalMoves = Intersect(verticalMoves, msb) & queenFile;
     
-    aMoves |= Intersect(horizontalMoves | verticalMoves, A->Queen);
-    
-    return aMoves;
-
+    return Intersect(aMoves, aPLocation);
 }
 
 /*
@@ -824,17 +861,14 @@ UInt64 PiecesQueenMoveEx(Pieces* A, Pieces* B)
     - Pieces A. The moving side pieces
     - Pieces B. The non-moving side pieces
  Return:
-    UInt64. The squares where the queen can go.
+    UInt64. The squares where the queens can go.
  Notes:
  */
 UInt64 PiecesQueenMove(Pieces* A, Pieces* B)
 {
-    Pieces movingSide;
     UInt64 aMoves;
-    
-    UInt64 queens  = A->Queen;
-    UInt64 square  = 0x1;
-    aMoves = 0;
+    UInt64 aPLocation, occupancy;
+    UInt64 queens = A->Queen;
     
     // Special case when there are no queens on the board
     if (queens == 0)
@@ -842,26 +876,18 @@ UInt64 PiecesQueenMove(Pieces* A, Pieces* B)
         return 0;
     }
     
-    memcpy(&movingSide, A, sizeof(Pieces));
-    // There may be more than one queen. Iterate the board
-    // and calculate the moves for each queen.
-    for (UInt64 i = 0; i < 64; i++, square <<= 1)
+    aPLocation = A->Occupancy;
+    occupancy  = aPLocation | B->Occupancy;
+    aMoves     = 0;
+    
+    // There may be more than one queen. Look up each queen
+    // by bit-scanning the occupied squares only.
+    while (queens != 0)
     {
-        if (queens & square)
-        {
-            // Found a rook. Move all other queens to reserved,
-            // so it doesn't interfere with the queens move calculation
-            movingSide.Queen    = square;
-            movingSide.Reserved = queens & ~square;
-            aMoves |= PiecesQueenMoveEx(&movingSide, B);
-            
-            movingSide.Queen    = queens;
-            movingSide.Reserved = 0;
-        }
-        
+        aMoves |= PiecesQueenAttacks(PopLeastSigBit(&queens), occupancy);
     }
     
-    return aMoves;
+    return Intersect(aMoves, aPLocation);
 }
 
 /*
@@ -884,17 +910,14 @@ UInt64 PiecesKingMoveFast(Pieces* A, Pieces* B)
     UInt64 king;
     
     king        = A->King;
-    aPLocation  = Union(A);
+    aPLocation  = A->Occupancy;
     
-    aMoves = (Intersect(king << 7, FILE_H) |
-              king << 8 |
-              Intersect(king << 9, FILE_A) |
-              Intersect(king << 1, FILE_A) |
-              Intersect(king >> 1, FILE_H) |
-              Intersect(king >> 7, FILE_A) |
-              king >> 8 |
-              Intersect(king >> 9, FILE_H));
+    if (king == 0)
+    {
+        return 0;
+    }
     
+    aMoves = PiecesKingAttacks(LeastSigBitIndex(king));
     aMoves = Intersect(aMoves, aPLocation);
     
     return aMoves;
@@ -994,18 +1017,21 @@ UInt64 PiecesGetAttackSquares(Pieces* A, Pieces* B)
  Return:
     bool - True if A is in check, false otherwise.
  Notes:
+    Only the squares attacking A's king are looked up, rather than
+    every square B attacks.
  */
 bool PiecesIsKingInCheck(Pieces* A, Pieces* B)
 {
-    UInt64 attackedSquares;
-    attackedSquares = PiecesGetAttackSquares(B, A);
+    UInt64 kingIndex;
     
-    if (attackedSquares & A->King)
+    if (A->King == 0)
     {
-        return true;
+        return false;
     }
     
-    return false;
+    kingIndex = LeastSigBitIndex(A->King);
+    
+    return PiecesIsSquareAttacked(B, kingIndex, A->Occupancy | B->Occupancy);
 }
 
 /*
@@ -27,9 +27,9 @@ struct PlayingState {
     // 0x2 = King Rook has moved
     // 0x4 = Queen Rook has moved
     
-    // The 
-    Move        LastMove;
-    PieceType   LastMovedPiece;
+    // The square behind a pawn this side just pushed two squares,
+    // which the other side may capture onto en passant. 0 otherwise.
+    UInt64 EnPassant;
 };
 
 struct Pieces {
@@ -41,10 +41,22 @@ struct Pieces {
     UInt64 King;
     UInt8  Color;
     PlayingState State;
-    UInt64 Reserved;  // Used as placeholder for multiple type pieces
-    UInt64 Reserved2; // Used as placeholder for legal move check
+    UInt64 Occupancy; // Union of the pieces above, see PiecesRefreshOccupancy
 };
 
+void PiecesInit();
+bool PiecesInitSliders(bool);
+void PiecesRefreshOccupancy(Pieces*);
+UInt64 PiecesRookAttacks(UInt64, UInt64);
+UInt64 PiecesBishopAttacks(UInt64, UInt64);
+UInt64 PiecesQueenAttacks(UInt64, UInt64);
+UInt64 PiecesBetween(UInt64, UInt64);
+UInt64 PiecesLine(UInt64, UInt64);
+UInt64 PiecesKnightAttacks(UInt64);
+UInt64 PiecesKingAttacks(UInt64);
+UInt64 PiecesPawnAttacks(UInt64, UInt64);
+UInt64 PiecesAttackersTo(Pieces*, UInt64, UInt64);
+bool PiecesIsSquareAttacked(Pieces*, UInt64, UInt64);
 UInt64 PiecesPawnMove(Pieces*, Pieces*);
 UInt64 PiecesKnightMove(Pieces*, Pieces*);
 UInt64 PiecesRookMove(Pieces*, Pieces*);
@@ -0,0 +1,970 @@
+#include "Search.hpp"
+#include "Transposition.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct SearchState;
+
+/*
+ SearchShared is what every thread of one search reads: the limits,
+ when the search started, the flag the main thread raises to stop
+ the others, and each thread's state so node counts can be summed.
+ */
+struct SearchShared {
+    SearchLimits Limits;
+    chrono::steady_clock::time_point Start;
+    atomic<bool> Stop;
+    vector<SearchState*> Threads;
+};
+
+/*
+ SearchState is what one thread carries from node to node: its own
+ copy of the board, its node count, the result of the deepest
+ iteration it completed, and the triangular PV table, where row Ply
+ holds the best line found from that ply down. Nodes is only written
+ by its own thread and only read by others.
+ */
+struct SearchState {
+    Board*         Position;
+    SearchShared*  Shared;
+    UInt64         Id;         // 0 for the main thread
+    atomic<UInt64> Nodes;
+    UInt64         OtherNodes; // The other threads' nodes, as last summed
+    bool           Stopped;
+    SearchResult   Result;
+    PackedMove     PV[SEARCH_MAX_PLY][SEARCH_MAX_PLY];
+    UInt64         PVLength[SEARCH_MAX_PLY];
+    PackedMove     Killers[SEARCH_MAX_PLY][2]; // Quiet moves that last cut off at each ply
+    Int32          History[2][64][64];         // How often a quiet move cut off, by color, from and to
+    PawnsTable*    Pawns;
+};
+
+// One pawn table for each thread Id, kept from search to search
+vector<PawnsTable*> SearchPawnTables;
+
+// The stages of a SearchPicker, in the order moves are returned
+#define SEARCH_STAGE_TABLE_MOVE        0
+#define SEARCH_STAGE_GENERATE_CAPTURES 1
+#define SEARCH_STAGE_CAPTURES          2
+#define SEARCH_STAGE_KILLERS           3
+#define SEARCH_STAGE_GENERATE_QUIETS   4
+#define SEARCH_STAGE_QUIETS            5
+#define SEARCH_STAGE_BAD_CAPTURES      6
+#define SEARCH_STAGE_DONE              7
+
+// History scores stay within this, in either direction
+#define SEARCH_HISTORY_MAX 16384
+
+// What a capture may gain beyond its victim's value before quiescence
+// search gives up on it as unable to raise alpha
+#define SEARCH_DELTA_MARGIN 200
+
+/*
+ SearchPicker hands out one node's moves best first, generating them
+ only as they are needed: the table move, which is checked but not
+ generated, then captures by MVV-LVA, then the killers, then quiet
+ moves by history, then the captures that lose material. A cutoff on
+ an early move skips the rest.
+ */
+struct SearchPicker {
+    Board*     Position;
+    UInt64     Stage;
+    MoveList   Moves;
+    Int32      Scores[MAX_MOVES];
+    UInt64     Next;
+    PackedMove TableMove;
+    PackedMove Killers[2];
+    UInt64     KillerIndex;
+    Int32      (*History)[64];
+    PackedMove BadCaptures[MAX_MOVES]; // Captures put off for losing material
+    UInt64     BadCount;
+    UInt64     BadNext;
+    bool       CapturesOnly; // Stop after the captures, for quiescence search
+};
+
+/*
+ Function: SearchEvaluate
+ Parameters:
+    - Board* Board. The position to score
+    - UInt64 Color. The side the score is for
+    - PawnsTable* Pawns. The pawn table to look the pawn structure up
+      in, NULL to compute it
+ Return:
+    Int32. The material, piece-square and pawn structure balance in
+    centipawns, positive if Color is ahead.
+ Notes:
+    Reads the running totals BoardMakeMove keeps in Board->Score, and
+    the pawn structure from the pawn table, so a leaf mostly costs a
+    blend of a few numbers rather than a pass over the bit boards.
+    The middlegame and endgame scores are weighted by how much of the
+    pieces (not pawns) are still on the board.
+ */
+Int32 SearchEvaluate(Board* Board, UInt64 Color, PawnsTable* Pawns)
+{
+    Int32       phase = (Board->Score.Phase < BOARD_PHASE_MAX) ? Board->Score.Phase : BOARD_PHASE_MAX;
+    PawnsEntry  computed;
+    PawnsEntry* pawns = &computed;
+    Int32       score;
+    
+    if (Pawns != NULL)
+    {
+        pawns = PawnsProbe(Pawns, Board);
+    }
+    else
+    {
+        PawnsEvaluate(Board, &computed);
+    }
+    
+    score = ((Board->Score.Middlegame + pawns->Middlegame + pawns->Shield[WHITE_PIECE] - pawns->Shield[BLACK_PIECE]) * phase +
+             (Board->Score.Endgame + pawns->Endgame) * (BOARD_PHASE_MAX - phase)) / BOARD_PHASE_MAX;
+    
+    return (Color == WHITE_PIECE) ? score : -score;
+}
+
+/*
+ Function: SearchElapsedEx
+ Parameters:
+    - SearchState* State
+ Return:
+    UInt64. Milliseconds since the search started.
+ Notes:
+ */
+UInt64 SearchElapsedEx(SearchState* State)
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - State->Shared->Start).count();
+}
+
+/*
+ Function: SearchCheckLimitsEx
+ Parameters:
+    - SearchState* State
+ Return:
+ Notes:
+    Sets Stopped once any thread has stopped the search, or once the
+    node or time limit is reached, and then stops the other threads.
+    Reading the clock and the other threads' counts is slow next to
+    a node, so they are only read every 1024 nodes.
+ */
+void SearchCheckLimitsEx(SearchState* State)
+{
+    SearchLimits* limits = &State->Shared->Limits;
+    UInt64        nodes  = State->Nodes.load(memory_order_relaxed);
+    
+    if (State->Shared->Stop.load(memory_order_relaxed) == true)
+    {
+        State->Stopped = true;
+        return;
+    }
+    
+    if ((nodes & 1023) == 0)
+    {
+        State->OtherNodes = 0;
+        for (UInt64 i = 0; i < State->Shared->Threads.size(); i++)
+        {
+            if (i != State->Id)
+            {
+                State->OtherNodes += State->Shared->Threads[i]->Nodes.load(memory_order_relaxed);
+            }
+        }
+        
+        if (limits->Time != 0 && SearchElapsedEx(State) >= limits->Time)
+        {
+            State->Stopped = true;
+        }
+    }
+    
+    if (limits->Nodes != 0 && nodes + State->OtherNodes >= limits->Nodes)
+    {
+        State->Stopped = true;
+    }
+    
+    if (State->Stopped == true)
+    {
+        State->Shared->Stop.store(true, memory_order_relaxed);
+    }
+}
+
+/*
+ Function: SearchIsDrawEx
+ Parameters:
+    - Board* Board. The position reached
+ Return:
+    bool. True if the position is drawn by the 50 move rule or has
+    been seen before with the same side to move.
+ Notes:
+    Only positions since the last capture or pawn move can repeat,
+    so the history is walked back at most HalfmoveClock plies. One
+    repetition is scored as a draw, as the side that could avoid it
+    gains nothing by repeating again.
+ */
+bool SearchIsDrawEx(Board* Board)
+{
+    UInt64 end;
+    
+    if (Board->HalfmoveClock >= 100)
+    {
+        return true;
+    }
+    
+    end = (Board->HalfmoveClock < Board->Ply) ? Board->HalfmoveClock : Board->Ply;
+    for (UInt64 i = 4; i <= end; i += 2)
+    {
+        if (Board->History[Board->Ply - i].Hash == Board->Hash)
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/*
+ Function: SearchPickerInitEx
+ Parameters:
+    - SearchPicker* Picker. The picker to set up
+    - SearchState* State. The thread searching
+    - UInt64 Ply. Plies from the root
+    - PackedMove TableMove. The move to try first, 0 for none
+    - bool CapturesOnly. True to return only captures and promotions
+      that do not lose material
+ Return:
+ Notes:
+ */
+void SearchPickerInitEx(SearchPicker* Picker, SearchState* State, UInt64 Ply, PackedMove TableMove, bool CapturesOnly)
+{
+    Picker->Position    = State->Position;
+    Picker->Stage       = SEARCH_STAGE_TABLE_MOVE;
+    Picker->Next        = 0;
+    Picker->TableMove   = TableMove;
+    Picker->Killers[0]  = State->Killers[Ply][0];
+    Picker->Killers[1]  = State->Killers[Ply][1];
+    Picker->KillerIndex = 0;
+    Picker->History     = State->History[State->Position->SideToMove];
+    Picker->Moves.Count = 0;
+    Picker->BadCount    = 0;
+    Picker->BadNext     = 0;
+    Picker->CapturesOnly = CapturesOnly;
+}
+
+/*
+ Function: SearchPickBestEx
+ Parameters:
+    - SearchPicker* Picker
+ Return:
+    PackedMove. The highest scored move not yet returned, 0 if none
+    are left.
+ Notes:
+    A selection sort done one step at a time, as most nodes never
+    get far down their list.
+ */
+PackedMove SearchPickBestEx(SearchPicker* Picker)
+{
+    UInt64     best = Picker->Next;
+    PackedMove move;
+    Int32      score;
+    
+    if (Picker->Next == Picker->Moves.Count)
+    {
+        return 0;
+    }
+    
+    for (UInt64 i = Picker->Next + 1; i < Picker->Moves.Count; i++)
+    {
+        if (Picker->Scores[i] > Picker->Scores[best])
+        {
+            best = i;
+        }
+    }
+    
+    move  = Picker->Moves.Moves[best];
+    score = Picker->Scores[best];
+    Picker->Moves.Moves[best]         = Picker->Moves.Moves[Picker->Next];
+    Picker->Scores[best]              = Picker->Scores[Picker->Next];
+    Picker->Moves.Moves[Picker->Next] = move;
+    Picker->Scores[Picker->Next]      = score;
+    Picker->Next++;
+    
+    return move;
+}
+
+/*
+ Function: SearchNextMoveEx
+ Parameters:
+    - SearchPicker* Picker
+ Return:
+    PackedMove. The next legal move to search, 0 once every move has
+    been returned.
+ Notes:
+    Captures are scored most valuable victim first, then least
+    valuable attacker; promotions add the value of the new piece.
+    A capture the static exchange says loses material is put off
+    until after the quiet moves, or dropped when only captures are
+    wanted. Killers are quiet moves that cut off at the same ply elsewhere in
+    the tree, and are only returned if legal here. No move is ever
+    returned twice.
+ */
+PackedMove SearchNextMoveEx(SearchPicker* Picker)
+{
+    Board*     board = Picker->Position;
+    PackedMove move;
+    UInt64     victim;
+    
+    switch (Picker->Stage) {
+        case SEARCH_STAGE_TABLE_MOVE:
+            Picker->Stage = SEARCH_STAGE_GENERATE_CAPTURES;
+            if (Picker->TableMove != 0 &&
+                BoardIsMoveLegal(board, board->SideToMove, Picker->TableMove) == true)
+            {
+                return Picker->TableMove;
+            }
+            [[fallthrough]];
+        case SEARCH_STAGE_GENERATE_CAPTURES:
+            BoardGenerateCaptures(board, board->SideToMove, &Picker->Moves);
+            for (UInt64 i = 0; i < Picker->Moves.Count; i++)
+            {
+                move   = Picker->Moves.Moves[i];
+                victim = (MoveFlags(move) == MOVE_EN_PASSANT) ? PAWN : MailboxType(board->Mailbox[MoveEndIndex(move)]);
+                Picker->Scores[i] = 8 * BoardPieceValues[victim] + BoardPieceValues[MovePromotionPiece(move)] -
+                                    MailboxType(board->Mailbox[MoveStartIndex(move)]);
+            }
+            Picker->Next  = 0;
+            Picker->Stage = SEARCH_STAGE_CAPTURES;
+            [[fallthrough]];
+        case SEARCH_STAGE_CAPTURES:
+            while ((move = SearchPickBestEx(Picker)) != 0)
+            {
+                if (move == Picker->TableMove)
+                {
+                    continue;
+                }
+                // Taking a piece worth at least the attacker cannot lose material
+                victim = (MoveFlags(move) == MOVE_EN_PASSANT) ? PAWN : MailboxType(board->Mailbox[MoveEndIndex(move)]);
+                if (BoardPieceValues[victim] < BoardPieceValues[MailboxType(board->Mailbox[MoveStartIndex(move)])] &&
+                    BoardSEE(board, move) < 0)
+                {
+                    Picker->BadCaptures[Picker->BadCount++] = move;
+                    continue;
+                }
+                return move;
+            }
+            if (Picker->CapturesOnly == true)
+            {
+                Picker->Stage = SEARCH_STAGE_DONE;
+                break;
+            }
+            Picker->Stage = SEARCH_STAGE_KILLERS;
+            [[fallthrough]];
+        case SEARCH_STAGE_KILLERS:
+            while (Picker->KillerIndex < 2)
+            {
+                move = Picker->Killers[Picker->KillerIndex++];
+                if (move != 0 && move != Picker->TableMove &&
+                    BoardIsMoveLegal(board, board->SideToMove, move) == true)
+                {
+                    return move;
+                }
+            }
+            Picker->Stage = SEARCH_STAGE_GENERATE_QUIETS;
+            [[fallthrough]];
+        case SEARCH_STAGE_GENERATE_QUIETS:
+            BoardGenerateQuiets(board, board->SideToMove, &Picker->Moves);
+            for (UInt64 i = 0; i < Picker->Moves.Count; i++)
+            {
+                move = Picker->Moves.Moves[i];
+                Picker->Scores[i] = Picker->History[MoveStartIndex(move)][MoveEndIndex(move)];
+            }
+            Picker->Next  = 0;
+            Picker->Stage = SEARCH_STAGE_QUIETS;
+            [[fallthrough]];
+        case SEARCH_STAGE_QUIETS:
+            while ((move = SearchPickBestEx(Picker)) != 0)
+            {
+                if (move != Picker->TableMove && move != Picker->Killers[0] && move != Picker->Killers[1])
+                {
+                    return move;
+                }
+            }
+            Picker->Stage = SEARCH_STAGE_BAD_CAPTURES;
+            [[fallthrough]];
+        case SEARCH_STAGE_BAD_CAPTURES:
+            if (Picker->BadNext < Picker->BadCount)
+            {
+                return Picker->BadCaptures[Picker->BadNext++];
+            }
+            Picker->Stage = SEARCH_STAGE_DONE;
+            [[fallthrough]];
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
+/*
+ Function: SearchUpdateQuietEx
+ Parameters:
+    - SearchState* State
+    - UInt64 Ply. Plies from the root
+    - UInt64 Depth. Plies left to search at the node
+    - PackedMove Move. The quiet move that cut off
+    - PackedMove* Tried. The quiet moves searched before it
+    - UInt64 TriedCount
+ Return:
+ Notes:
+    Move becomes the first killer at Ply and gains history, and the
+    quiet moves that did not cut off before it lose history. Deeper
+    cutoffs count for more, and each update moves a score only part
+    of the way towards SEARCH_HISTORY_MAX, so old results fade.
+ */
+void SearchUpdateQuietEx(SearchState* State, UInt64 Ply, UInt64 Depth, PackedMove Move, PackedMove* Tried, UInt64 TriedCount)
+{
+    Int32 (*history)[64] = State->History[State->Position->SideToMove];
+    Int32  bonus = (Depth < 20) ? (Int32)(Depth * Depth) : 400;
+    Int32* entry;
+    
+    if (State->Killers[Ply][0] != Move)
+    {
+        State->Killers[Ply][1] = State->Killers[Ply][0];
+        State->Killers[Ply][0] = Move;
+    }
+    
+    entry   = &history[MoveStartIndex(Move)][MoveEndIndex(Move)];
+    *entry += bonus - *entry * bonus / SEARCH_HISTORY_MAX;
+    for (UInt64 i = 0; i < TriedCount; i++)
+    {
+        entry   = &history[MoveStartIndex(Tried[i])][MoveEndIndex(Tried[i])];
+        *entry += -bonus - *entry * bonus / SEARCH_HISTORY_MAX;
+    }
+}
+
+/*
+ Function: SearchScoreToTableEx
+ Parameters:
+    - Int32 Score. A score from the search
+    - UInt64 Ply. Plies from the root the score was found at
+ Return:
+    Int32. The score to store in the transposition table.
+ Notes:
+    Mate scores count plies from the root. The table keeps them as
+    plies from the stored position instead, which holds wherever the
+    position is reached again.
+ */
+Int32 SearchScoreToTableEx(Int32 Score, UInt64 Ply)
+{
+    if (Score >= SEARCH_MATE - SEARCH_MAX_PLY)
+    {
+        return Score + (Int32)Ply;
+    }
+    if (Score <= -(SEARCH_MATE - SEARCH_MAX_PLY))
+    {
+        return Score - (Int32)Ply;
+    }
+    
+    return Score;
+}
+
+/*
+ Function: SearchScoreFromTableEx
+ Parameters:
+    - Int32 Score. A score from the transposition table
+    - UInt64 Ply. Plies from the root the score is used at
+ Return:
+    Int32. The score as the search counts it.
+ Notes:
+    The inverse of SearchScoreToTableEx.
+ */
+Int32 SearchScoreFromTableEx(Int32 Score, UInt64 Ply)
+{
+    if (Score >= SEARCH_MATE - SEARCH_MAX_PLY)
+    {
+        return Score - (Int32)Ply;
+    }
+    if (Score <= -(SEARCH_MATE - SEARCH_MAX_PLY))
+    {
+        return Score + (Int32)Ply;
+    }
+    
+    return Score;
+}
+
+/*
+ Function: SearchQuiescenceEx
+ Parameters:
+    - SearchState* State
+    - UInt64 Ply. Plies from the root
+    - Int32 Alpha. The score the side to move is already sure of
+    - Int32 Beta. The score the opponent is already sure of
+ Return:
+    Int32. The score for the side to move once the captures on the
+    board have been played out, bounded as for SearchNegamaxEx.
+ Notes:
+    Ends the main search on a quiet position, so a leaf is not scored
+    in the middle of an exchange. The side to move may stand pat on
+    the static score, as it need not capture, and only searches
+    captures and promotions to do better. A capture that would stay
+    below alpha even winning its victim plus SEARCH_DELTA_MARGIN is
+    skipped. In check there is no standing pat, and every evasion is
+    searched so that mates are seen.
+ */
+Int32 SearchQuiescenceEx(SearchState* State, UInt64 Ply, Int32 Alpha, Int32 Beta)
+{
+    Board*  board = State->Position;
+    Pieces* A     = (board->SideToMove == WHITE_PIECE) ? &board->White : &board->Black;
+    Pieces* B     = (board->SideToMove == WHITE_PIECE) ? &board->Black : &board->White;
+    SearchPicker picker;
+    PackedMove move;
+    UInt64  moveCount = 0;
+    Int32   score, standPat, bestScore;
+    bool    isInCheck;
+    
+    State->Nodes.store(State->Nodes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    SearchCheckLimitsEx(State);
+    if (State->Stopped == true)
+    {
+        return 0;
+    }
+    
+    standPat = SearchEvaluate(board, board->SideToMove, State->Pawns);
+    if (Ply == SEARCH_MAX_PLY - 1)
+    {
+        return standPat;
+    }
+    
+    isInCheck = PiecesIsKingInCheck(A, B);
+    bestScore = -SEARCH_INFINITE;
+    if (isInCheck == false)
+    {
+        if (standPat >= Beta)
+        {
+            return standPat;
+        }
+        if (standPat > Alpha)
+        {
+            Alpha = standPat;
+        }
+        bestScore = standPat;
+    }
+    
+    SearchPickerInitEx(&picker, State, Ply, 0, !isInCheck);
+    while ((move = SearchNextMoveEx(&picker)) != 0)
+    {
+        moveCount++;
+        
+        // Delta pruning
+        if (isInCheck == false && MoveIsPromotion(move) == false &&
+            standPat + BoardPieceValues[(MoveFlags(move) == MOVE_EN_PASSANT) ? PAWN : MailboxType(board->Mailbox[MoveEndIndex(move)])] +
+            SEARCH_DELTA_MARGIN <= Alpha)
+        {
+            continue;
+        }
+        
+        BoardMakeMove(board, board->SideToMove, move);
+        score = -SearchQuiescenceEx(State, Ply + 1, -Beta, -Alpha);
+        BoardUnmakeMove(board);
+        
+        if (State->Stopped == true)
+        {
+            return 0;
+        }
+        
+        if (score > bestScore)
+        {
+            bestScore = score;
+        }
+        if (score > Alpha)
+        {
+            Alpha = score;
+        }
+        if (Alpha >= Beta)
+        {
+            break;
+        }
+    }
+    
+    if (isInCheck == true && moveCount == 0)
+    {
+        return -(SEARCH_MATE - (Int32)Ply);
+    }
+    
+    return bestScore;
+}
+
+/*
+ Function: SearchNegamaxEx
+ Parameters:
+    - SearchState* State
+    - UInt64 Depth. Plies left to search
+    - UInt64 Ply. Plies from the root
+    - Int32 Alpha. The score the side to move is already sure of
+    - Int32 Beta. The score the opponent is already sure of
+ Return:
+    Int32. The score for the side to move. A score at or below Alpha
+    or at or above Beta is only a bound.
+ Notes:
+    The score is never used once Stopped is set. Below the root, an
+    entry in the transposition table searched at least as deep ends
+    the search here when its bound settles the score.
+ */
+Int32 SearchNegamaxEx(SearchState* State, UInt64 Depth, UInt64 Ply, Int32 Alpha, Int32 Beta)
+{
+    Board*   board = State->Position;
+    Pieces*  A     = (board->SideToMove == WHITE_PIECE) ? &board->White : &board->Black;
+    Pieces*  B     = (board->SideToMove == WHITE_PIECE) ? &board->Black : &board->White;
+    SearchPicker picker;
+    TranspositionEntry entry = {0, 0, 0, 0};
+    PackedMove move, bestMove = 0;
+    PackedMove quiets[MAX_MOVES];
+    UInt64   quietCount = 0, moveCount = 0;
+    Int32    score, bestScore = -SEARCH_INFINITE, alphaStart = Alpha;
+    
+    State->PVLength[Ply] = 0;
+    if (Ply != 0 && SearchIsDrawEx(board) == true)
+    {
+        return 0;
+    }
+    
+    if (Depth == 0)
+    {
+        return SearchQuiescenceEx(State, Ply, Alpha, Beta);
+    }
+    
+    State->Nodes.store(State->Nodes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    SearchCheckLimitsEx(State);
+    if (State->Stopped == true)
+    {
+        return 0;
+    }
+    
+    if (Ply == SEARCH_MAX_PLY - 1)
+    {
+        return SearchEvaluate(board, board->SideToMove, State->Pawns);
+    }
+    
+    if (TranspositionProbe(board->Hash, &entry) == true && Ply != 0 && entry.Depth >= Depth)
+    {
+        score = SearchScoreFromTableEx(entry.Score, Ply);
+        if (entry.Bound == BOUND_EXACT ||
+            (entry.Bound == BOUND_LOWER && score >= Beta) ||
+            (entry.Bound == BOUND_UPPER && score <= Alpha))
+        {
+            return score;
+        }
+    }
+    
+    SearchPickerInitEx(&picker, State, Ply, (Ply == 0 && State->PV[0][0] != 0) ? State->PV[0][0] : entry.Move, false);
+    while ((move = SearchNextMoveEx(&picker)) != 0)
+    {
+        moveCount++;
+        BoardMakeMove(board, board->SideToMove, move);
+        TranspositionPrefetch(board->Hash);
+        score = -SearchNegamaxEx(State, Depth - 1, Ply + 1, -Beta, -Alpha);
+        BoardUnmakeMove(board);
+        
+        if (State->Stopped == true)
+        {
+            return 0;
+        }
+        
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove  = move;
+        }
+        if (score > Alpha)
+        {
+            // The line from here is this move, then the child's line
+            Alpha = score;
+            State->PV[Ply][0] = move;
+            memcpy(&State->PV[Ply][1], State->PV[Ply + 1], State->PVLength[Ply + 1] * sizeof(PackedMove));
+            State->PVLength[Ply] = State->PVLength[Ply + 1] + 1;
+        }
+        if (Alpha >= Beta)
+        {
+            if (MoveIsCapture(move) == false && MoveIsPromotion(move) == false)
+            {
+                SearchUpdateQuietEx(State, Ply, Depth, move, quiets, quietCount);
+            }
+            break;
+        }
+        
+        if (MoveIsCapture(move) == false && MoveIsPromotion(move) == false)
+        {
+            quiets[quietCount++] = move;
+        }
+    }
+    
+    if (moveCount == 0)
+    {
+        return (PiecesIsKingInCheck(A, B) == true) ? -(SEARCH_MATE - (Int32)Ply) : 0;
+    }
+    
+    TranspositionStore(board->Hash, bestMove, SearchScoreToTableEx(bestScore, Ply), Depth,
+                       (bestScore >= Beta) ? BOUND_LOWER : (bestScore > alphaStart) ? BOUND_EXACT : BOUND_UPPER);
+    
+    return bestScore;
+}
+
+/*
+ Function: SearchIterateEx
+ Parameters:
+    - SearchState* State. The thread to search with
+ Return:
+ Notes:
+    Iterative deepening: depth 1, 2, 3... are searched in turn, each
+    trying the last iteration's best move first, until a limit is
+    reached. An iteration cut short by a limit is thrown away, except
+    the first, so there is always a move to play. The main thread
+    starts no new iteration once half the time is used, as it would
+    not finish. Helper threads with an odd Id start a ply deeper, so
+    the threads are seldom on the same depth at once and fill the
+    table from different subtrees.
+ */
+void SearchIterateEx(SearchState* State)
+{
+    SearchLimits* limits = &State->Shared->Limits;
+    SearchResult* result = &State->Result;
+    UInt64        maxDepth;
+    Int32         score;
+    
+    maxDepth = (limits->Depth != 0 && limits->Depth < SEARCH_MAX_PLY) ? limits->Depth : SEARCH_MAX_PLY - 1;
+    for (UInt64 depth = 1 + (State->Id & 0x1); depth <= maxDepth; depth++)
+    {
+        score = SearchNegamaxEx(State, depth, 0, -SEARCH_INFINITE, SEARCH_INFINITE);
+        if (State->Stopped == true && result->Depth != 0)
+        {
+            break;
+        }
+        
+        if (State->PVLength[0] != 0)
+        {
+            result->BestMove = State->PV[0][0];
+            result->Score    = score;
+            result->Depth    = depth;
+            result->PVLength = State->PVLength[0];
+            memcpy(result->PV, State->PV[0], State->PVLength[0] * sizeof(PackedMove));
+        }
+        
+        if (State->Stopped == true ||
+            (State->Id == 0 && limits->Time != 0 && SearchElapsedEx(State) * 2 >= limits->Time))
+        {
+            break;
+        }
+    }
+}
+
+/*
+ Function: SearchBestMove
+ Parameters:
+    - Board* Board. The position to search, left unchanged
+    - UInt64 Color. The side to find a move for, which must be
+      Board->SideToMove
+    - SearchLimits Limits. When to stop searching, and on how many
+      threads
+ Return:
+    SearchResult. The best move, score and principal variation of
+    the deepest iteration the main thread completed, with the nodes
+    searched by every thread. If the main thread was stopped before
+    completing one, the deepest helper result is used instead. An
+    empty result, with no move, if Color is not the side to move.
+ Notes:
+    Lazy SMP: every thread runs its own iterative deepening on its
+    own copy of the board, and they share only the transposition
+    table, so what one thread finds cuts the others' searches short.
+    The first thread to reach a limit stops them all, and the main
+    thread stops the helpers when it is done. Each search is a new generation of the table,
+    which is kept from one search to the next.
+ */
+SearchResult SearchBestMove(Board* Board, UInt64 Color, SearchLimits Limits)
+{
+    SearchShared   shared;
+    SearchState*   state;
+    SearchResult   result;
+    vector<thread> helpers;
+    MoveList       moveList;
+    UInt64         threads, history;
+    
+    memset(&result, 0, sizeof(result));
+    threads = 0;
+    
+    shared.Limits = Limits;
+    shared.Start  = chrono::steady_clock::now();
+    shared.Stop.store(false, memory_order_relaxed);
+    
+    // Board->Hash keys the table and the repetition check for the side to move only
+    if (Color != Board->SideToMove)
+    {
+        goto End;
+    }
+    TranspositionNewSearch();
+    
+    // Each thread searches a copy, with as much history as leaves room to search
+    threads = (Limits.Threads > 1) ? Limits.Threads : 1;
+    history = (Board->Ply + SEARCH_MAX_PLY <= MAX_PLY) ? Board->Ply : 0;
+    for (UInt64 i = 0; i < threads; i++)
+    {
+        state = new SearchState;
+        state->Position = new struct Board;
+        memcpy(state->Position, Board, offsetof(struct Board, History) + history * sizeof(BoardUndo));
+        state->Position->Ply = history;
+        state->Shared     = &shared;
+        state->Id         = i;
+        state->OtherNodes = 0;
+        state->Stopped    = false;
+        state->PV[0][0]   = 0;
+        memset(state->Killers, 0, sizeof(state->Killers));
+        memset(state->History, 0, sizeof(state->History));
+        if (i == SearchPawnTables.size())
+        {
+            SearchPawnTables.push_back(new PawnsTable());
+        }
+        state->Pawns = SearchPawnTables[i];
+        state->Nodes.store(0, memory_order_relaxed);
+        memset(&state->Result, 0, sizeof(state->Result));
+        shared.Threads.push_back(state);
+    }
+    
+    BoardGenerateLegalMoves(Board, Color, &moveList);
+    if (moveList.Count == 0)
+    {
+        goto End;
+    }
+    
+    for (UInt64 i = 1; i < threads; i++)
+    {
+        helpers.emplace_back(SearchIterateEx, shared.Threads[i]);
+    }
+    SearchIterateEx(shared.Threads[0]);
+    
+    shared.Stop.store(true, memory_order_relaxed);
+    for (UInt64 i = 0; i < helpers.size(); i++)
+    {
+        helpers[i].join();
+    }
+    
+    // A helper's result stands in only if the main thread was stopped before finishing depth 1
+    result = shared.Threads[0]->Result;
+    for (UInt64 i = 1; i < threads; i++)
+    {
+        if (result.Depth == 0 && shared.Threads[i]->Result.Depth != 0)
+        {
+            result = shared.Threads[i]->Result;
+        }
+    }
+    if (result.BestMove == 0)
+    {
+        result.BestMove = moveList.Moves[0];
+    }
+    
+End:
+    for (UInt64 i = 0; i < threads; i++)
+    {
+        result.Nodes += shared.Threads[i]->Nodes.load(memory_order_relaxed);
+        delete shared.Threads[i]->Position;
+        delete shared.Threads[i];
+    }
+    result.Time           = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - shared.Start).count();
+    result.NodesPerSecond = result.Nodes * 1000 / (result.Time != 0 ? result.Time : 1);
+    
+    return result;
+}
+
+/*
+ Function: SearchMain
+ Parameters:
+    - Int32 argc. The number of arguments after "search"
+    - char** argv. The arguments after "search"
+ Return:
+    Int32. The process exit code.
+ Notes:
+    Usage: Chess search [depth <n>] [nodes <n>] [time <ms>] [threads <n>] [hash <mb>] [fen "<fen>"]
+    Searches the FEN position, or the start position without one,
+    and prints the best move with its depth, score, nodes, nodes per
+    second and principal variation. Without a limit the search runs
+    for 10 seconds. A <mb> megabyte transposition table, 64MB by
+    default, is shared by all threads.
+ */
+Int32 SearchMain(Int32 argc, char** argv)
+{
+    static Board board;
+    SearchLimits limits = {0, 0, 0, 1};
+    SearchResult result;
+    UInt64 hashSize = TRANSPOSITION_DEFAULT_MB;
+    const char* fen = NULL;
+    Int32  exitCode = 0;
+    
+    for (Int32 i = 0; i < argc; i++)
+    {
+        if (string(argv[i]) == "depth" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            limits.Depth = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "nodes" && i + 1 < argc && atoll(argv[i + 1]) > 0)
+        {
+            limits.Nodes = atoll(argv[++i]);
+        }
+        else if (string(argv[i]) == "time" && i + 1 < argc && atoll(argv[i + 1]) > 0)
+        {
+            limits.Time = atoll(argv[++i]);
+        }
+        else if (string(argv[i]) == "threads" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            limits.Threads = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "hash" && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+        {
+            hashSize = atoi(argv[++i]);
+        }
+        else if (string(argv[i]) == "fen" && i + 1 < argc)
+        {
+            fen = argv[++i];
+        }
+        else
+        {
+            cout << RED << "Error" << WHITE << ": Unknown search option " << argv[i] << endl;
+            exitCode = 1;
+            goto End;
+        }
+    }
+    
+    if (limits.Depth == 0 && limits.Nodes == 0 && limits.Time == 0)
+    {
+        limits.Time = 10000;
+    }
+    
+    if (fen == NULL)
+    {
+        BoardInit(&board);
+    }
+    else if (BoardFromFEN(&board, fen) == false)
+    {
+        cout << RED << "Error" << WHITE << ": Invalid FEN " << fen << endl;
+        exitCode = 1;
+        goto End;
+    }
+    
+    if (TranspositionInit(hashSize) == false)
+    {
+        cout << RED << "Error" << WHITE << ": Cannot allocate a " << hashSize << "MB transposition table" << endl;
+        exitCode = 1;
+        goto End;
+    }
+    
+    result = SearchBestMove(&board, board.SideToMove, limits);
+    
+    cout << "bestmove " << (result.BestMove != 0 ? MoveToString(result.BestMove) : "none")
+         << " depth " << result.Depth << " score " << result.Score
+         << " nodes " << result.Nodes << " time " << result.Time << "ms"
+         << " nps " << result.NodesPerSecond << " pv";
+    for (UInt64 i = 0; i < result.PVLength; i++)
+    {
+        cout << " " << MoveToString(result.PV[i]);
+    }
+    cout << endl;
+    
+    TranspositionInit(0);
+    
+End:
+    return exitCode;
+}
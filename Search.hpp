@@ -0,0 +1,42 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include "Board.hpp"
+#include "Pawns.hpp"
+
+#define SEARCH_MAX_PLY  128
+#define SEARCH_INFINITE 32000
+#define SEARCH_MATE     31000 // Mate in n plies scores SEARCH_MATE - n
+
+#define SearchIsMate(score) ((score) >= SEARCH_MATE - SEARCH_MAX_PLY || (score) <= -(SEARCH_MATE - SEARCH_MAX_PLY))
+
+/*
+ SearchLimits bounds one SearchBestMove call. A limit left at 0 is
+ not a limit; with every limit 0 the search runs to SEARCH_MAX_PLY.
+ */
+struct SearchLimits {
+    UInt64 Depth;   // Deepest iteration to search
+    UInt64 Nodes;   // Nodes to search, over all threads, before stopping
+    UInt64 Time;    // Milliseconds to search before stopping
+    UInt64 Threads; // Threads to search with, 0 or 1 for one
+};
+
+/*
+ SearchResult is the outcome of the deepest iteration completed.
+ */
+struct SearchResult {
+    PackedMove BestMove; // 0 if the side to move has no legal move
+    Int32      Score;    // Centipawns for the side to move
+    UInt64     Depth;
+    UInt64     Nodes;    // Nodes searched over every iteration and thread
+    UInt64     Time;     // Milliseconds spent
+    UInt64     NodesPerSecond;
+    PackedMove PV[SEARCH_MAX_PLY];
+    UInt64     PVLength;
+};
+
+Int32 SearchEvaluate(Board*, UInt64, PawnsTable* = NULL);
+SearchResult SearchBestMove(Board*, UInt64, SearchLimits);
+Int32 SearchMain(Int32, char**);
+
+#endif // SEARCH_HPP
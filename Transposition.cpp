@@ -0,0 +1,202 @@
+#include "Transposition.hpp"
+#include <cstdlib>
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#define TRANSPOSITION_HUGE_PAGE (2ULL << 20)
+
+TranspositionBucket* TranspositionTable      = NULL;
+UInt64               TranspositionMask       = 0;
+UInt64               TranspositionGeneration = 0;
+
+/*
+ An entry's fields within its 64 bit word. Bound is never 0 in an
+ entry that was stored, which tells a stored entry from an empty one.
+ */
+#define EntryKey(data)        ((data) & 0xFFFF)
+#define EntryMove(data)       ((PackedMove)((data) >> 16))
+#define EntryScore(data)      ((Int16)((data) >> 32))
+#define EntryDepth(data)      ((UInt8)((data) >> 48))
+#define EntryBound(data)      (((data) >> 56) & 0x3)
+#define EntryGeneration(data) ((data) >> 58)
+
+/*
+ Function: TranspositionInit
+ Parameters:
+    - UInt64 MegaBytes. The table size, 0 to turn the table off
+ Return:
+    bool. True if the table was allocated or turned off, false if
+    the memory could not be allocated.
+ Notes:
+    The bucket count is rounded down to a power of two. A table that
+    is a whole number of huge pages is aligned to them and, on Linux,
+    the kernel is asked to back it with huge pages, which saves most
+    of the TLB misses a probe would otherwise take.
+ */
+bool TranspositionInit(UInt64 MegaBytes)
+{
+    UInt64 buckets = (MegaBytes << 20) / sizeof(TranspositionBucket);
+    UInt64 bytes, alignment;
+    
+    free(TranspositionTable);
+    TranspositionTable = NULL;
+    TranspositionMask  = 0;
+    
+    if (buckets == 0)
+    {
+        return true;
+    }
+    
+    buckets   = MostSigBit(buckets);
+    bytes     = buckets * sizeof(TranspositionBucket);
+    alignment = (bytes % TRANSPOSITION_HUGE_PAGE == 0) ? TRANSPOSITION_HUGE_PAGE : sizeof(TranspositionBucket);
+    
+    TranspositionTable = (TranspositionBucket*)aligned_alloc(alignment, bytes);
+    if (TranspositionTable == NULL)
+    {
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(TranspositionTable, bytes, MADV_HUGEPAGE);
+#endif
+    
+    for (UInt64 i = 0; i < buckets; i++)
+    {
+        new (&TranspositionTable[i]) TranspositionBucket;
+    }
+    TranspositionMask = buckets - 1;
+    TranspositionClear();
+    
+    return true;
+}
+
+/*
+ Function: TranspositionClear
+ Parameters:
+ Return:
+ Notes:
+    Empties every entry, as before a new game.
+ */
+void TranspositionClear()
+{
+    if (TranspositionTable == NULL)
+    {
+        return;
+    }
+    
+    for (UInt64 i = 0; i <= TranspositionMask; i++)
+    {
+        for (UInt64 j = 0; j < TRANSPOSITION_BUCKET_SIZE; j++)
+        {
+            TranspositionTable[i].Entries[j].store(0, memory_order_relaxed);
+        }
+    }
+    TranspositionGeneration = 0;
+}
+
+/*
+ Function: TranspositionNewSearch
+ Parameters:
+ Return:
+ Notes:
+    Starts a new generation. Entries from earlier searches are kept
+    and still used, but are replaced before entries of this one.
+ */
+void TranspositionNewSearch()
+{
+    TranspositionGeneration = (TranspositionGeneration + 1) & 0x3F;
+}
+
+/*
+ Function: TranspositionProbe
+ Parameters:
+    - UInt64 Hash. The position to look up
+    - TranspositionEntry* Entry. Receives the entry found
+ Return:
+    bool. True if the position has an entry.
+ Notes:
+    Only 16 bits of the hash are checked past the bucket index, so
+    an entry can, rarely, belong to another position. Its move must
+    be checked for legality before it is played.
+ */
+bool TranspositionProbe(UInt64 Hash, TranspositionEntry* Entry)
+{
+    TranspositionBucket* bucket;
+    UInt64 data;
+    
+    if (TranspositionTable == NULL)
+    {
+        return false;
+    }
+    
+    bucket = &TranspositionTable[Hash & TranspositionMask];
+    for (UInt64 i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+    {
+        data = bucket->Entries[i].load(memory_order_relaxed);
+        if (EntryKey(data) == (Hash >> 48) && EntryBound(data) != 0)
+        {
+            Entry->Move  = EntryMove(data);
+            Entry->Score = EntryScore(data);
+            Entry->Depth = EntryDepth(data);
+            Entry->Bound = (UInt8)EntryBound(data);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/*
+ Function: TranspositionStore
+ Parameters:
+    - UInt64 Hash. The position searched
+    - PackedMove Move. The best move found, 0 if none
+    - Int32 Score. The score found
+    - UInt64 Depth. The depth searched
+    - UInt64 Bound. BOUND_UPPER, BOUND_LOWER or BOUND_EXACT
+ Return:
+ Notes:
+    The position's own entry is overwritten if it has one, keeping
+    its move when no new move is given. Otherwise the entry in the
+    bucket worth least is replaced: the shallowest, with 8 plies of
+    depth taken off for each generation the entry is old.
+ */
+void TranspositionStore(UInt64 Hash, PackedMove Move, Int32 Score, UInt64 Depth, UInt64 Bound)
+{
+    TranspositionBucket* bucket;
+    atomic<UInt64>*      replace;
+    UInt64 data, key = Hash >> 48;
+    Int64  worth, replaceWorth = INT64_MAX;
+    
+    if (TranspositionTable == NULL)
+    {
+        return;
+    }
+    
+    bucket  = &TranspositionTable[Hash & TranspositionMask];
+    replace = &bucket->Entries[0];
+    for (UInt64 i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+    {
+        data = bucket->Entries[i].load(memory_order_relaxed);
+        if (EntryKey(data) == key && EntryBound(data) != 0)
+        {
+            replace = &bucket->Entries[i];
+            Move    = (Move == 0) ? EntryMove(data) : Move;
+            break;
+        }
+        
+        worth = (data == 0) ? INT64_MIN :
+                (Int64)EntryDepth(data) - 8 * (Int64)((TranspositionGeneration - EntryGeneration(data)) & 0x3F);
+        if (worth < replaceWorth)
+        {
+            replace      = &bucket->Entries[i];
+            replaceWorth = worth;
+        }
+    }
+    
+    data = key | ((UInt64)Move << 16) | ((UInt64)(UInt16)Score << 32) |
+           ((Depth < 0xFF ? Depth : 0xFF) << 48) | (Bound << 56) | (TranspositionGeneration << 58);
+    replace->store(data, memory_order_relaxed);
+}
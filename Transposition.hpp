@@ -0,0 +1,63 @@
+#ifndef TRANSPOSITION_HPP
+#define TRANSPOSITION_HPP
+
+#include "Foundation.hpp"
+#include <atomic>
+
+#define TRANSPOSITION_BUCKET_SIZE 8 // Entries in one 64 byte bucket
+#define TRANSPOSITION_DEFAULT_MB  64
+
+// What a stored score says about the true score
+#define BOUND_UPPER 1 // Every move failed low, the score is at most this
+#define BOUND_LOWER 2 // A move failed high, the score is at least this
+#define BOUND_EXACT 3
+
+/*
+ TranspositionEntry is one entry read back from the table. In the
+ table it is packed into a single 64 bit word, along with the top 16
+ bits of the position's hash and the generation (search) it was
+ stored in, so that an entry is read and written whole even while
+ other threads share the table.
+ */
+struct TranspositionEntry {
+    PackedMove Move;
+    Int16      Score;
+    UInt8      Depth;
+    UInt8      Bound;
+};
+
+/*
+ A bucket is the entries one hash can be stored in. Buckets are
+ aligned to cache lines, so a probe reads from memory once.
+ */
+struct alignas(64) TranspositionBucket {
+    atomic<UInt64> Entries[TRANSPOSITION_BUCKET_SIZE];
+};
+
+extern TranspositionBucket* TranspositionTable;
+extern UInt64               TranspositionMask;
+
+bool TranspositionInit(UInt64);
+void TranspositionClear();
+void TranspositionNewSearch();
+bool TranspositionProbe(UInt64, TranspositionEntry*);
+void TranspositionStore(UInt64, PackedMove, Int32, UInt64, UInt64);
+
+/*
+ Function: TranspositionPrefetch
+ Parameters:
+    - UInt64 Hash. A position that will be probed soon
+ Return:
+ Notes:
+    Starts loading the position's bucket into cache, so the probe
+    does not wait on memory. Call it as soon as the hash is known.
+ */
+inline void TranspositionPrefetch(UInt64 Hash)
+{
+    if (TranspositionTable != NULL)
+    {
+        __builtin_prefetch(&TranspositionTable[Hash & TranspositionMask]);
+    }
+}
+
+#endif // TRANSPOSITION_HPP
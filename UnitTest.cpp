@@ -1,5 +1,9 @@
 #include "UnitTest.hpp"
 #include "Board.hpp"
+#include "Game.hpp"
+#include "Perft.hpp"
+#include "Search.hpp"
+#include "Transposition.hpp"
 
 #define abs(X) ((X) < 0 ? -(X) : (X))
 
@@ -10,6 +14,7 @@ bool PawnsFirstMove()
     Pieces white = {0};
     Pieces black = {0};
     white.Pawns = RANK_2;
+    PiecesRefreshOccupancy(&white);
     
     result = PiecesPawnMove(&white, &black);
     return (result == (RANK_3 | RANK_4));
@@ -23,6 +28,8 @@ bool PawnsFirstMoveBlocking()
     Pieces black = {0};
     white.Pawns = RANK_2;
     black.Pawns = 0x0F000000;
+    PiecesRefreshOccupancy(&white);
+    PiecesRefreshOccupancy(&black);
     
     result = PiecesPawnMove(&white, &black);
     return (result == (RANK_3 | (RANK_4 & 0xF0000000)));
@@ -36,6 +43,7 @@ bool PawnMiddleGame()
     
     board.White.Pawns = d3 | e4 | f5;
     board.Black.Pawns = d5 | e5 | e6;
+    BoardRefresh(&board);
     
     result = PiecesPawnMove(&board.White, &board.Black);
     
@@ -50,6 +58,7 @@ bool PawnEdgeAttacks()
     
     board.White.Pawns = g4 | a4 | b4 | a5;
     board.Black.Pawns = h5;
+    BoardRefresh(&board);
     
     result = PiecesPawnMove(&board.Black, &board.White);
     
@@ -64,8 +73,8 @@ bool PawnEnPassantWhite()
     
     board.White.Pawns = e5;
     board.Black.Pawns = d5;
-    board.Black.State.LastMove = {d7, d5};
-    board.Black.State.LastMovedPiece = PAWN;
+    board.Black.State.EnPassant = d6;
+    BoardRefresh(&board);
     
     result = PiecesPawnMove(&board.White, &board.Black);
     
@@ -80,8 +89,8 @@ bool PawnEnPassantBlack()
     
     board.White.Pawns = f4;
     board.Black.Pawns = e4;
-    board.White.State.LastMove = {f2, f4};
-    board.White.State.LastMovedPiece = PAWN;
+    board.White.State.EnPassant = f3;
+    BoardRefresh(&board);
     
     result = PiecesPawnMove(&board.Black, &board.White);
     
@@ -95,6 +104,7 @@ bool KnightMovement()
     Pieces white = {0};
     Pieces black = {0};
     white.Knights = c5;
+    PiecesRefreshOccupancy(&white);
 
     result = PiecesKnightMove(&white, &black);
     return (result == 0xA1100110A0000);
@@ -107,6 +117,7 @@ bool KnightEdge()
     BoardZeroInit(&board);
     
     board.White.Knights = a1 | e4 | h8;
+    BoardRefresh(&board);
     
     result = PiecesKnightMove(&board.White, &board.Black);
     
@@ -120,6 +131,7 @@ bool KnightZeroKnights()
     BoardZeroInit(&board);
     
     board.White.Knights = 0;
+    BoardRefresh(&board);
     
     result = PiecesKnightMove(&board.White, &board.Black);
     
@@ -133,6 +145,7 @@ bool RookMovement()
     Pieces white = {0};
     Pieces black = {0};
     white.Rooks = d4;
+    PiecesRefreshOccupancy(&white);
     result = PiecesRookMove(&white, &black);
 
     return (result == 0x8080808F7080808);
@@ -147,6 +160,8 @@ bool RookCapture()
     white.Rooks = d4;
     white.Pawns = d1 | d6 | h4 | b4;
     black.Pawns = d2 | d7 | g4 | a4;
+    PiecesRefreshOccupancy(&white);
+    PiecesRefreshOccupancy(&black);
     
     result = PiecesRookMove(&white, &black);
 
@@ -170,6 +185,7 @@ bool RookMultipleRooks()
     Pieces black = {0};
     
     white.Rooks  = a1 | h1;
+    PiecesRefreshOccupancy(&white);
     
     result = PiecesRookMove(&white, &black);
     return (result == 0x818181818181817E);
@@ -183,6 +199,7 @@ bool RookMiddleGame()
     
     board.White.Rooks = e1 | e4 | e8;
     board.Black.Pawns = e3 | h7 | b4;
+    BoardRefresh(&board);
     
     result = PiecesRookMove(&board.White, &board.Black);
     
@@ -197,6 +214,7 @@ bool RookHorizontalAttack()
 
     board.Black.Rooks = f7;
     board.Black.Pawns = d7 | c7 | b7;
+    BoardRefresh(&board);
     
     result = PiecesRookMove(&board.Black, &board.White);
 
@@ -210,6 +228,7 @@ bool BishopMovement()
     Pieces white = {0};
     Pieces black = {0};
     white.Bishops = d4;
+    PiecesRefreshOccupancy(&white);
     
     result = PiecesBishopMove(&white, &black);
     
@@ -226,6 +245,8 @@ bool BishopCapture()
     
     white.Pawns = f6 | c3;
     black.Pawns = b6;
+    PiecesRefreshOccupancy(&white);
+    PiecesRefreshOccupancy(&black);
     
     result = PiecesBishopMove(&white, &black);
     return (result == 0x21400102040);
@@ -238,6 +259,7 @@ bool BishopMultipleBishops()
     BoardZeroInit(&board);
     
     board.White.Bishops = a1 | b2 | c3 | d4 | e5 | f6 | g7 | h8;
+    BoardRefresh(&board);
     
     result = PiecesBishopMove(&board.White, &board.Black);
     return (result == 0x2A158A45A251A854);
@@ -250,6 +272,7 @@ bool QueenMovement()
     Pieces white = {0};
     Pieces black = {0};
     white.Queen = d4;
+    PiecesRefreshOccupancy(&white);
     
     result = PiecesQueenMove(&white, &black);
 
@@ -263,6 +286,7 @@ bool QueenMultipleQueens()
     Pieces white = {0};
     Pieces black = {0};
     white.Queen = d4 | e4;
+    PiecesRefreshOccupancy(&white);
     
     result = PiecesQueenMove(&white, &black);
     
@@ -277,6 +301,7 @@ bool QueenMultipleCapture()
     
     board.White.Queen = a2;
     board.Black.Queen = g2 | b1 | f7 | a7;
+    BoardRefresh(&board);
     
     result = PiecesQueenMove(&board.White, &board.Black);
     
@@ -292,6 +317,7 @@ bool KingMovement()
     
     board.White.King = d4;
     board.White.Bishops = d5;
+    BoardRefresh(&board);
     
     result = PiecesKingMove(&board.White, &board.Black);
     return (result == 0x14141C0000);
@@ -311,6 +337,7 @@ bool KingIsCheckmated()
     board.Black.Color= BLACK_PIECE;
     
     board.White.Rooks= a8;
+    BoardRefresh(&board);
     // King should have no legal moves, as it's black-ranked mated.
     
     result = BoardAttemptMove(&board, move, BLACK_PIECE, false);
@@ -335,12 +362,38 @@ bool KingCastle()
     board.White.State.Castle = 0;
     board.White.King  = e1;
     board.White.Rooks = a1 | h1;
+    BoardRefresh(&board);
     
     result = PiecesKingMove(&board.White, &board.Black);
     
     return (result == 0x386C);
 }
 
+bool KingAttackersTo()
+{
+    Board board;
+    UInt64 result;
+    BoardZeroInit(&board);
+    
+    board.White.King    = e1;
+    board.Black.King    = e8;
+    board.Black.Pawns   = d5 | f6;
+    board.Black.Knights = c3 | g4;
+    board.Black.Rooks   = e7;
+    board.Black.Bishops = a8;
+    board.White.Pawns   = d4 | e2;
+    BoardRefresh(&board);
+    
+    // d5 pawn, c3 knight and e7 rook attack e4. The a8 bishop
+    // is blocked by d5, the f6 pawn attacks e5 not e4, and e2
+    // shields the king from the rook.
+    result = PiecesAttackersTo(&board.Black, 28, Union((&board.White)) | Union((&board.Black)));
+    
+    return (result == (d5 | c3 | e7) &&
+            PiecesIsKingInCheck(&board.White, &board.Black) == false &&
+            PiecesIsSquareAttacked(&board.Black, 13, Union((&board.White)) | Union((&board.Black))) == true);
+}
+
 bool BoardFirstMove()
 {
     Board board;
@@ -362,6 +415,7 @@ bool BoardPieceCollision()
     Board board = {0};
     
     board.White.Rooks = a1 | h1;
+    BoardRefresh(&board);
     
     Move move;
     move.StartSquare = a1;
@@ -446,6 +500,7 @@ bool BoardCheckmateIterator()
     board.White.Rooks = a8;
     board.Black.King  = g8;
     board.Black.Pawns = f7 | g7 | h7;
+    BoardRefresh(&board);
     
     isCheckmated = BoardCheckmated(&board.White, &board.Black);
     
@@ -464,6 +519,7 @@ bool BoardKnightCheckmate()
     board.Black.King  = h8;
     board.Black.Rooks = g8;
     board.Black.Pawns = g7 | h7;
+    BoardRefresh(&board);
     
     isCheckmated = BoardCheckmated(&board.White, &board.Black);
     
@@ -573,6 +629,7 @@ bool BoardStalemate()
     board.White.King  = e6;
     board.Black.King  = e8;
     board.White.Pawns = e7;
+    BoardRefresh(&board);
     
     isStalemated = BoardStalemated(&board.White, &board.Black);
     
@@ -589,6 +646,7 @@ bool BoardNotStalemate()
     board.White.King  = f1;
     board.Black.King  = h8;
     board.White.Rooks = g1 | b6;
+    BoardRefresh(&board);
     
     isStalemated = BoardStalemated(&board.White, &board.Black);
     
@@ -605,12 +663,744 @@ bool BoardMateralDraw()
     board.Black.King = c5;
     board.White.Knights = a1;
     board.Black.Bishops = c1 | d2;
+    BoardRefresh(&board);
     
     isDraw = BoardIsMaterialDraw(&board.White, &board.Black);
     
     return (isDraw == true);
 }
 
+bool BoardLegalMovesKiwipete()
+{
+    Board board;
+    MoveList moveList;
+    BoardZeroInit(&board);
+    
+    board.White.State.Castle = 0;
+    board.White.King    = e1;
+    board.White.Queen   = f3;
+    board.White.Rooks   = a1 | h1;
+    board.White.Bishops = d2 | e2;
+    board.White.Knights = c3 | e5;
+    board.White.Pawns   = a2 | b2 | c2 | d5 | e4 | f2 | g2 | h2;
+    
+    board.Black.State.Castle = 0;
+    board.Black.King    = e8;
+    board.Black.Queen   = e7;
+    board.Black.Rooks   = a8 | h8;
+    board.Black.Bishops = a6 | g7;
+    board.Black.Knights = b6 | f6;
+    board.Black.Pawns   = a7 | c7 | d7 | e6 | f7 | g6 | b4 | h3;
+    BoardRefresh(&board);
+    
+    // 46 moves plus both castles for white, 43 for black
+    BoardGenerateLegalMoves(&board, WHITE_PIECE, &moveList);
+    if (moveList.Count != 48)
+    {
+        return false;
+    }
+    
+    BoardGenerateLegalMoves(&board, BLACK_PIECE, &moveList);
+    return (moveList.Count == 43);
+}
+
+bool BoardLegalMovesPromotion()
+{
+    Board board;
+    MoveList moveList;
+    BoardZeroInit(&board);
+    
+    board.White.King  = a1;
+    board.White.Pawns = b7 | e5;
+    board.Black.King  = h8;
+    board.Black.Knights = c8;
+    board.Black.Pawns = d5;
+    board.Black.State.EnPassant = d6;
+    BoardRefresh(&board);
+    
+    UInt64 captures, promotions, enPassants;
+    
+    // Kings: 3, b7-b8 and b7xc8: 8 promotions, e5-e6 and e5xd6 en passant
+    BoardGenerateLegalMoves(&board, WHITE_PIECE, &moveList);
+    
+    captures = promotions = enPassants = 0;
+    for (UInt64 i = 0; i < moveList.Count; i++)
+    {
+        captures   += MoveIsCapture(moveList.Moves[i]);
+        promotions += MoveIsPromotion(moveList.Moves[i]);
+        enPassants += (MoveFlags(moveList.Moves[i]) == MOVE_EN_PASSANT);
+    }
+    
+    return (moveList.Count == 13 && captures == 5 && promotions == 8 && enPassants == 1);
+}
+
+// True if the incrementally kept mailbox, occupancy and hash match a rebuild
+bool BoardIsSynced(Board* board)
+{
+    Board rebuilt;
+    
+    rebuilt.White = board->White;
+    rebuilt.Black = board->Black;
+    rebuilt.SideToMove = board->SideToMove;
+    BoardRefresh(&rebuilt);
+    
+    return (memcmp(rebuilt.Mailbox, board->Mailbox, sizeof(board->Mailbox)) == 0 &&
+            rebuilt.Hash == board->Hash &&
+            rebuilt.PawnHash == board->PawnHash &&
+            rebuilt.Score.Middlegame == board->Score.Middlegame &&
+            rebuilt.Score.Endgame == board->Score.Endgame &&
+            rebuilt.Score.Phase == board->Score.Phase &&
+            rebuilt.Occupancy == board->Occupancy &&
+            rebuilt.White.Occupancy == board->White.Occupancy &&
+            rebuilt.Black.Occupancy == board->Black.Occupancy);
+}
+
+bool BoardMakeUnmakeKiwipete()
+{
+    Board board;
+    Pieces white, black;
+    MoveList whiteMoves, blackMoves;
+    UInt64 leafCount = 0;
+    bool isSynced = true;
+    BoardZeroInit(&board);
+    
+    board.White.State.Castle = 0;
+    board.White.King    = e1;
+    board.White.Queen   = f3;
+    board.White.Rooks   = a1 | h1;
+    board.White.Bishops = d2 | e2;
+    board.White.Knights = c3 | e5;
+    board.White.Pawns   = a2 | b2 | c2 | d5 | e4 | f2 | g2 | h2;
+    
+    board.Black.State.Castle = 0;
+    board.Black.King    = e8;
+    board.Black.Queen   = e7;
+    board.Black.Rooks   = a8 | h8;
+    board.Black.Bishops = a6 | g7;
+    board.Black.Knights = b6 | f6;
+    board.Black.Pawns   = a7 | c7 | d7 | e6 | f7 | g6 | b4 | h3;
+    
+    BoardRefresh(&board);
+    white = board.White;
+    black = board.Black;
+    
+    // Every move and reply must be taken back to the same position,
+    // and the mailbox, occupancy, hashes and score must follow the bit boards throughout
+    BoardGenerateLegalMoves(&board, WHITE_PIECE, &whiteMoves);
+    for (UInt64 i = 0; i < whiteMoves.Count; i++)
+    {
+        BoardMakeMove(&board, WHITE_PIECE, whiteMoves.Moves[i]);
+        BoardGenerateLegalMoves(&board, BLACK_PIECE, &blackMoves);
+        for (UInt64 j = 0; j < blackMoves.Count; j++)
+        {
+            BoardMakeMove(&board, BLACK_PIECE, blackMoves.Moves[j]);
+            isSynced = isSynced && BoardIsSynced(&board);
+            BoardUnmakeMove(&board);
+            leafCount += 1;
+        }
+        BoardUnmakeMove(&board);
+    }
+    
+    return (leafCount == 2039 && board.Ply == 0 && isSynced && BoardIsSynced(&board) &&
+            BoardComparePieces(&board.White, &white) &&
+            BoardComparePieces(&board.Black, &black));
+}
+
+bool BoardHashTransposition()
+{
+    Board board;
+    Move move;
+    UInt64 startHash, e4Hash;
+    bool isMoveLegal;
+    BoardInit(&board);
+    
+    startHash = board.Hash;
+    
+    // Knights out and back again reach the start position
+    move = {g1, f3};
+    isMoveLegal = BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    move = {g8, f6};
+    isMoveLegal = isMoveLegal && BoardAttemptMove(&board, move, BLACK_PIECE, true);
+    move = {f3, g1};
+    isMoveLegal = isMoveLegal && BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    move = {f6, g8};
+    isMoveLegal = isMoveLegal && BoardAttemptMove(&board, move, BLACK_PIECE, true);
+    
+    if (isMoveLegal == false || board.Hash != startHash)
+    {
+        return false;
+    }
+    
+    // The same squares with the other side to move hash differently
+    move = {e2, e4};
+    BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    e4Hash = board.Hash;
+    board.SideToMove = WHITE_PIECE;
+    
+    return (e4Hash != startHash && e4Hash != BoardComputeHash(&board));
+}
+
+bool BoardFENRoundTrip()
+{
+    Board board, start;
+    char fen[BOARD_FEN_MAX];
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR w Kq d6 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "r3k2r/8/8/8/8/8/8/R3K2R b KQ - 37 112",
+    };
+    
+    for (UInt64 i = 0; i < sizeof(fens) / sizeof(fens[0]); i++)
+    {
+        if (BoardFromFEN(&board, fens[i]) == false)
+        {
+            return false;
+        }
+        BoardToFEN(&board, fen);
+        if (strcmp(fen, fens[i]) != 0)
+        {
+            return false;
+        }
+    }
+    
+    // The start FEN is the same position as BoardInit
+    BoardFromFEN(&board, fens[0]);
+    BoardInit(&start);
+    
+    return (BoardCompare(&board, &start) == true && board.Hash == start.Hash &&
+            BoardFromFEN(&board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1") == false &&
+            BoardFromFEN(&board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1") == false &&
+            BoardFromFEN(&board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1") == false &&
+            BoardFromFEN(&board, "8/8/8/8/8/8/8/8 b - - 0 1") == false &&
+            BoardFromFEN(&board, "8/8/8/8/8/8/8/R3K3 w - - 0 1") == false &&
+            BoardFromFEN(&board, "4k3/8/8/8/8/8/8/R3KK2 w - - 0 1") == false &&
+            BoardFromFEN(&board, "P3k3/8/8/8/8/8/8/4K3 w - - 0 1") == false &&
+            BoardFromFEN(&board, "4k3/8/8/8/8/8/8/4R1K1 w - - 0 1") == false);
+}
+
+bool BoardHalfmoveClock()
+{
+    Board board;
+    MoveList moveList;
+    Move move;
+    bool isMoveLegal;
+    BoardInit(&board);
+    
+    // Knight moves count up, a pawn move starts the count again
+    move = {g1, f3};
+    isMoveLegal = BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    move = {g8, f6};
+    isMoveLegal = isMoveLegal && BoardAttemptMove(&board, move, BLACK_PIECE, true);
+    if (isMoveLegal == false || board.HalfmoveClock != 2 || board.FullmoveNumber != 2)
+    {
+        return false;
+    }
+    
+    move = {e2, e4};
+    BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    if (board.HalfmoveClock != 0 || board.FullmoveNumber != 2 || board.White.State.EnPassant != e3)
+    {
+        return false;
+    }
+    
+    // Unmaking puts both counters back
+    BoardFromFEN(&board, "4k3/8/8/8/8/8/8/4K2R b K - 99 60");
+    BoardGenerateLegalMoves(&board, BLACK_PIECE, &moveList);
+    BoardMakeMove(&board, BLACK_PIECE, moveList.Moves[0]);
+    if (board.HalfmoveClock != 100 || board.FullmoveNumber != 61)
+    {
+        return false;
+    }
+    BoardUnmakeMove(&board);
+    
+    return (board.HalfmoveClock == 99 && board.FullmoveNumber == 60);
+}
+
+bool BoardFiftyMoveDraw()
+{
+    Board board;
+    Move move;
+    bool isMoveLegal;
+    
+    // The hundredth quiet ply draws the game
+    BoardFromFEN(&board, "4k3/8/8/8/8/8/8/R3K3 w - - 99 60");
+    if (GameGetGameResult(&board, BLACK_PIECE) != Progressing)
+    {
+        return false;
+    }
+    move = {a1, a2};
+    isMoveLegal = BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    if (isMoveLegal == false || GameGetGameResult(&board, WHITE_PIECE) != Draw)
+    {
+        return false;
+    }
+    
+    // A pawn move on the hundredth ply does not
+    BoardFromFEN(&board, "4k3/8/8/8/8/8/P7/R3K3 w - - 99 60");
+    move = {a2, a3};
+    isMoveLegal = BoardAttemptMove(&board, move, WHITE_PIECE, true);
+    return (isMoveLegal == true && GameGetGameResult(&board, WHITE_PIECE) == Progressing);
+}
+
+bool BoardCapturesAndQuiets()
+{
+    static Board board;
+    MoveList all, captures, quiets;
+    bool isSplit = true;
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    };
+    
+    // Captures and quiets together are the legal moves, with promotions among the captures
+    for (UInt64 i = 0; i < sizeof(fens) / sizeof(fens[0]); i++)
+    {
+        BoardFromFEN(&board, fens[i]);
+        BoardGenerateLegalMoves(&board, board.SideToMove, &all);
+        BoardGenerateCaptures(&board, board.SideToMove, &captures);
+        BoardGenerateQuiets(&board, board.SideToMove, &quiets);
+        isSplit = isSplit && (captures.Count + quiets.Count == all.Count);
+        
+        for (UInt64 j = 0; j < captures.Count; j++)
+        {
+            isSplit = isSplit && (MoveIsCapture(captures.Moves[j]) || MoveIsPromotion(captures.Moves[j]));
+        }
+        for (UInt64 j = 0; j < quiets.Count; j++)
+        {
+            isSplit = isSplit && !MoveIsCapture(quiets.Moves[j]) && !MoveIsPromotion(quiets.Moves[j]);
+        }
+    }
+    
+    return isSplit;
+}
+
+bool BoardMoveLegality()
+{
+    static Board board;
+    MoveList moveList;
+    bool isListed, isAgreed = true;
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/8/8/KPp4r/5p1k/8/4P1P1/8 w - c6 0 2",
+        "4k3/8/8/8/1b6/8/3P4/4K2R w K - 0 1",
+    };
+    
+    // Every one of the 65536 packed values is legal exactly when it is listed
+    for (UInt64 i = 0; i < sizeof(fens) / sizeof(fens[0]); i++)
+    {
+        BoardFromFEN(&board, fens[i]);
+        BoardGenerateLegalMoves(&board, board.SideToMove, &moveList);
+        for (UInt64 move = 0; move <= 0xFFFF; move++)
+        {
+            isListed = false;
+            for (UInt64 j = 0; j < moveList.Count; j++)
+            {
+                isListed = isListed || (moveList.Moves[j] == move);
+            }
+            isAgreed = isAgreed && (BoardIsMoveLegal(&board, board.SideToMove, (PackedMove)move) == isListed);
+        }
+    }
+    
+    return isAgreed;
+}
+
+bool BoardStaticExchange()
+{
+    static Board board;
+    struct { const char* FEN; UInt64 Start, End, Flags; Int32 Score; } cases[] = {
+        {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", e1, e5, MOVE_CAPTURE, 100},
+        {"3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", d2, d5, MOVE_CAPTURE, 100}, // X-ray behind the rook
+        {"3rk3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", d2, d5, MOVE_CAPTURE, -400},
+        {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", e5, d6, MOVE_EN_PASSANT, 0},
+        {"r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", b7, b8, MOVE_PROMOTION_QUEEN, -100},
+        {"4k3/8/8/8/8/8/1p6/R3K3 b - - 0 1", b2, a1, MOVE_PROMOTION_QUEEN | MOVE_CAPTURE, 1300},
+    };
+    PackedMove move;
+    bool isCorrect = true;
+    
+    for (UInt64 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        BoardFromFEN(&board, cases[i].FEN);
+        move      = MoveMake(LeastSigBitIndex(cases[i].Start), LeastSigBitIndex(cases[i].End), cases[i].Flags);
+        isCorrect = isCorrect && (BoardSEE(&board, move) == cases[i].Score);
+        
+        // The same move unpacked, with its flags left for the board to supply
+        isCorrect = isCorrect && (BoardSEE(&board, MoveUnpack(move)) == cases[i].Score);
+    }
+    
+    return isCorrect;
+}
+
+bool BoardScoreSymmetry()
+{
+    static Board board, mirrored;
+    bool isSymmetric;
+    
+    // Both sides score the same from the start, and from a position and its mirror image
+    BoardInit(&board);
+    isSymmetric = (board.Score.Middlegame == 0 && board.Score.Endgame == 0 &&
+                   board.Score.Phase == BOARD_PHASE_MAX);
+    
+    BoardFromFEN(&board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    BoardFromFEN(&mirrored, "r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1");
+    isSymmetric = isSymmetric &&
+                  board.Score.Middlegame == -mirrored.Score.Middlegame &&
+                  board.Score.Endgame == -mirrored.Score.Endgame &&
+                  board.Score.Phase == mirrored.Score.Phase &&
+                  SearchEvaluate(&board, WHITE_PIECE) == SearchEvaluate(&mirrored, BLACK_PIECE);
+    
+    // With a knight each and no other pieces, the knights make up the whole phase
+    BoardFromFEN(&board, "4k3/8/8/3n4/8/4N3/8/4K3 w - - 0 1");
+    isSymmetric = isSymmetric && board.Score.Phase == 2;
+    
+    return isSymmetric;
+}
+
+bool BoardPackedMoveRoundTrip()
+{
+    Move move = {b7, c8, KNIGHT};
+    PackedMove packed = MovePack(move);
+    Move unpacked = MoveUnpack(packed);
+    
+    return (sizeof(PackedMove) == 2 &&
+            MoveStartIndex(packed) == 49 && MoveEndIndex(packed) == 58 &&
+            MovePromotionPiece(packed) == KNIGHT &&
+            unpacked.StartSquare == b7 && unpacked.EndSquare == c8 &&
+            unpacked.Promotion == KNIGHT);
+}
+
+bool PerftStartPosition()
+{
+    static Board board;
+    BoardInit(&board);
+    
+    return (PerftCount(&board, 4) == 197281 &&
+            PerftCountParallel(&board, 4, 3) == 197281);
+}
+
+bool PerftKiwipete()
+{
+    static Board board;
+    bool isCountGood;
+    BoardFromFEN(&board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    
+    isCountGood = (PerftCount(&board, 3) == 97862 &&
+                   PerftCountParallel(&board, 3, 4) == 97862);
+    
+    // Counts must not change with a table, filled or not
+    PerftTableInit(1);
+    isCountGood = isCountGood && (PerftCount(&board, 3) == 97862 &&
+                                  PerftCountParallel(&board, 3, 4) == 97862 &&
+                                  PerftCount(&board, 3) == 97862);
+    PerftTableInit(0);
+    
+    return isCountGood;
+}
+
+bool PerftPositions()
+{
+    static Board board;
+    bool isCountGood;
+    
+    isCountGood = BoardFromFEN(&board, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1") &&
+                  PerftCount(&board, 5) == 674624;
+    isCountGood = isCountGood &&
+                  BoardFromFEN(&board, "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1") &&
+                  PerftCount(&board, 4) == 422333;
+    
+    return isCountGood;
+}
+
+bool PerftSliderBackends()
+{
+    static UInt64 rook[64][256], bishop[64][256];
+    static Board board;
+    UInt64 state = 0x9E3779B97F4A7C15ULL;
+    UInt64 occupancy[256];
+    bool isCountGood = true;
+    
+    // Sparse and dense random occupancies, from a fixed xorshift seed
+    for (UInt64 i = 0; i < 256; i++)
+    {
+        occupancy[i] = 0;
+        for (UInt64 j = 0; j < 1 + i % 3; j++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            occupancy[i] = (j == 0) ? state : (occupancy[i] & state);
+        }
+    }
+    
+    // The magic tables must give a correct perft on their own
+    PiecesInitSliders(false);
+    for (UInt64 square = 0; square < 64; square++)
+    {
+        for (UInt64 i = 0; i < 256; i++)
+        {
+            rook[square][i]   = PiecesRookAttacks(square, occupancy[i]);
+            bishop[square][i] = PiecesBishopAttacks(square, occupancy[i]);
+        }
+    }
+    BoardFromFEN(&board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    isCountGood = (PerftCount(&board, 3) == 97862);
+    
+    // PEXT, where the CPU has it, must agree with the magics everywhere
+    if (PiecesInitSliders(true) == true)
+    {
+        for (UInt64 square = 0; square < 64; square++)
+        {
+            for (UInt64 i = 0; i < 256; i++)
+            {
+                isCountGood = isCountGood &&
+                              rook[square][i] == PiecesRookAttacks(square, occupancy[i]) &&
+                              bishop[square][i] == PiecesBishopAttacks(square, occupancy[i]);
+            }
+        }
+        isCountGood = isCountGood && (PerftCount(&board, 3) == 97862);
+    }
+    
+    PiecesInit();
+    return isCountGood;
+}
+
+bool SearchMateInOne()
+{
+    static Board board;
+    SearchLimits limits = {3, 0, 0, 1};
+    SearchResult result;
+    
+    // Back rank mate, and the queen takes f7 in the Scholar's mate
+    BoardFromFEN(&board, "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    if (MoveToString(result.BestMove) != "a1a8" || result.Score != SEARCH_MATE - 1 || result.PVLength != 1)
+    {
+        return false;
+    }
+    
+    BoardFromFEN(&board, "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    
+    return (MoveToString(result.BestMove) == "h5f7" && SearchIsMate(result.Score));
+}
+
+bool SearchMateInTwo()
+{
+    static Board board;
+    SearchLimits limits = {4, 0, 0, 1};
+    SearchResult result;
+    
+    // One rook takes the 7th rank, the other mates on the 8th
+    BoardFromFEN(&board, "7k/8/8/8/8/8/R7/1R4K1 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    
+    return (result.Score == SEARCH_MATE - 3 && result.PVLength == 3 && result.PV[0] == result.BestMove);
+}
+
+bool SearchWinsMaterial()
+{
+    static Board board;
+    SearchLimits limits = {2, 0, 0, 1};
+    SearchResult result;
+    
+    BoardFromFEN(&board, "4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    if (MoveToString(result.BestMove) != "d1d5" || result.PVLength != 2)
+    {
+        return false;
+    }
+    
+    // The score is that of the position at the end of the PV
+    BoardMakeMove(&board, WHITE_PIECE, result.PV[0]);
+    BoardMakeMove(&board, BLACK_PIECE, result.PV[1]);
+    
+    return (result.Score == SearchEvaluate(&board, WHITE_PIECE) && result.Score > 0);
+}
+
+bool SearchQuiescence()
+{
+    static Board board;
+    SearchLimits limits = {1, 0, 0, 1};
+    SearchResult result;
+    
+    // A depth 1 search sees that the pawn on d5 is defended...
+    BoardFromFEN(&board, "4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    if (MoveToString(result.BestMove) == "d1d5" || result.Score < 700)
+    {
+        return false;
+    }
+    
+    // ...and that this one is not
+    BoardFromFEN(&board, "4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    BoardMakeMove(&board, WHITE_PIECE, result.BestMove);
+    
+    return (MoveToString(result.BestMove) == "d1d5" && result.Score == SearchEvaluate(&board, WHITE_PIECE));
+}
+
+bool SearchLimitsAndNoMoves()
+{
+    static Board board;
+    SearchLimits limits = {0, 5000, 0, 1};
+    SearchResult result;
+    
+    // A node limit stops the search, and there is still a move to play
+    BoardInit(&board);
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    if (result.Nodes > 5000 || result.BestMove == 0 || board.Ply != 0)
+    {
+        return false;
+    }
+    
+    // Stalemated: no move to return
+    BoardFromFEN(&board, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    limits.Depth = 3;
+    result = SearchBestMove(&board, BLACK_PIECE, limits);
+    if (result.BestMove != 0 || result.Depth != 0)
+    {
+        return false;
+    }
+    
+    // Only the side to move can be searched
+    BoardInit(&board);
+    result = SearchBestMove(&board, BLACK_PIECE, limits);
+    
+    return (result.BestMove == 0 && result.Depth == 0 && result.Nodes == 0);
+}
+
+bool PawnsStructure()
+{
+    static Board board, withKnight;
+    PawnsTable* table = new PawnsTable();
+    PawnsEntry* entry;
+    bool isCorrect;
+    
+    // c2 is doubled behind c3, c3 and d5 are passed, h2 is passed and isolated
+    BoardFromFEN(&board, "4k3/8/8/3P4/8/2P5/2P4p/4K3 w - - 0 1");
+    entry = PawnsProbe(table, &board);
+    isCorrect = (entry->Key == board.PawnHash &&
+                 entry->Passed[WHITE_PIECE] == (c3 | d5) && entry->Passed[BLACK_PIECE] == h2 &&
+                 entry->Middlegame == (-10 + 10 + 25) - (-5 + 60) &&
+                 entry->Endgame == (-20 + 20 + 60) - (-15 + 150));
+    
+    // A knight more leaves the pawn key alone, so the entry is found again...
+    BoardFromFEN(&withKnight, "4k3/8/8/3P4/8/2P5/2P4p/4K1N1 w - - 0 1");
+    isCorrect = isCorrect && entry->Shield[WHITE_PIECE] == 0 && entry->Shield[BLACK_PIECE] == 0 &&
+                withKnight.PawnHash == board.PawnHash && PawnsProbe(table, &withKnight) == entry;
+    
+    // ...and with the king moved behind its pawns, only the shield changes
+    BoardFromFEN(&withKnight, "4k3/8/8/3P4/8/2P5/2P4p/3K2N1 w - - 0 1");
+    isCorrect = isCorrect && PawnsProbe(table, &withKnight) == entry &&
+                entry->Shield[WHITE_PIECE] == 10 + 5 &&
+                entry->Middlegame == (-10 + 10 + 25) - (-5 + 60);
+    delete table;
+    
+    return isCorrect;
+}
+
+bool SearchGameRepetition()
+{
+    static Board board;
+    SearchLimits limits = {3, 0, 0, 1};
+    SearchResult result;
+    Move moves[] = {{g1, f3}, {h8, g8}, {f3, g1}};
+    bool isMoveLegal = true;
+    
+    // A rook down, Black takes the draw by going back to the position the game started from
+    BoardFromFEN(&board, "7k/8/8/8/8/8/8/R5NK w - - 0 1");
+    for (UInt64 i = 0; i < sizeof(moves) / sizeof(moves[0]); i++)
+    {
+        isMoveLegal = isMoveLegal && BoardAttemptMove(&board, moves[i], board.SideToMove, true);
+    }
+    result = SearchBestMove(&board, BLACK_PIECE, limits);
+    
+    return (isMoveLegal && board.Ply == 3 && MoveToString(result.BestMove) == "g8h8" && result.Score == 0);
+}
+
+bool SearchLazySMP()
+{
+    static Board board;
+    SearchLimits limits = {6, 0, 0, 4};
+    SearchResult result, limitedResult;
+    
+    // Helpers share the table and still find the same mate
+    TranspositionInit(1);
+    BoardFromFEN(&board, "7k/8/8/8/8/8/R7/1R4K1 w - - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    
+    // The node limit counts every thread's nodes
+    BoardInit(&board);
+    limits = {0, 20000, 0, 4};
+    limitedResult = SearchBestMove(&board, WHITE_PIECE, limits);
+    TranspositionInit(0);
+    
+    return (result.Score == SEARCH_MATE - 3 && result.Depth == 6 && result.PV[0] == result.BestMove &&
+            limitedResult.BestMove != 0 && limitedResult.Nodes < 20000 + 4 * 1024);
+}
+
+bool TranspositionStoreProbe()
+{
+    TranspositionEntry entry;
+    UInt64 hash = 0x123456789ABCDEF0;
+    UInt64 other;
+    bool isStored;
+    
+    TranspositionInit(1);
+    
+    // A stored entry comes back whole, and its move outlives a store without one
+    TranspositionStore(hash, MoveMake(12, 28, MOVE_DOUBLE_PUSH), -SEARCH_MATE + 5, 7, BOUND_EXACT);
+    TranspositionStore(hash, 0, -250, 9, BOUND_UPPER);
+    isStored = TranspositionProbe(hash, &entry) &&
+               entry.Move == MoveMake(12, 28, MOVE_DOUBLE_PUSH) && entry.Score == -250 &&
+               entry.Depth == 9 && entry.Bound == BOUND_UPPER &&
+               TranspositionProbe(hash ^ (0x1ULL << 63), &entry) == false;
+    
+    // A full bucket gives up its shallowest entry, and then its oldest
+    for (UInt64 i = 1; i < TRANSPOSITION_BUCKET_SIZE; i++)
+    {
+        TranspositionStore(hash + (i << 48), 0, 0, 10 + i, BOUND_LOWER);
+    }
+    other = hash + ((UInt64)TRANSPOSITION_BUCKET_SIZE << 48);
+    TranspositionStore(other, 0, 0, 20, BOUND_LOWER);
+    isStored = isStored && TranspositionProbe(other, &entry) && TranspositionProbe(hash, &entry) == false;
+    
+    TranspositionNewSearch();
+    TranspositionNewSearch();
+    TranspositionStore(hash, 0, 0, 1, BOUND_LOWER);
+    isStored = isStored && TranspositionProbe(hash, &entry) && TranspositionProbe(other, &entry) &&
+               TranspositionProbe(hash + (1ULL << 48), &entry) == false;
+    
+    TranspositionInit(0);
+    
+    return (sizeof(TranspositionBucket) == 64 && isStored);
+}
+
+bool TranspositionSearch()
+{
+    static Board board;
+    SearchLimits limits = {5, 0, 0, 1};
+    SearchResult result, tableResult, mateResult;
+    
+    // The table saves nodes without changing what is found
+    BoardFromFEN(&board, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    result = SearchBestMove(&board, WHITE_PIECE, limits);
+    
+    TranspositionInit(1);
+    tableResult = SearchBestMove(&board, WHITE_PIECE, limits);
+    
+    BoardFromFEN(&board, "7k/8/8/8/8/8/R7/1R4K1 w - - 0 1");
+    limits.Depth = 6;
+    mateResult = SearchBestMove(&board, WHITE_PIECE, limits);
+    TranspositionInit(0);
+    
+    return (tableResult.Score == result.Score && tableResult.Nodes < result.Nodes &&
+            mateResult.Score == SEARCH_MATE - 3);
+}
+
 bool PerfSimpleGamePerf()
 {
     clock_t start;
@@ -684,8 +1474,10 @@ bool (*KnightTests[])() = {KnightMovement, KnightEdge, KnightZeroKnights};
 bool (*RookTests[])() = {RookMovement, RookCapture, RookEmptyBoard, RookMultipleRooks, RookMiddleGame, RookHorizontalAttack};
 bool (*BishopTests[])() = {BishopMovement, BishopCapture, BishopMultipleBishops};
 bool (*QueenTests[])() = {QueenMovement, QueenMultipleQueens, QueenMultipleCapture};
-bool (*KingTests[])() = {KingMovement, KingIsCheckmated, KingCastle,};
-bool (*BoardTests[])() = {BoardFirstMove, BoardPieceCollision, BoardSimplePawnPush, BoardCheckmateIterator, BoardKnightCheckmate, BoardFoolsMate, /*BoardPromotedQueen*/ BoardStalemate, BoardNotStalemate, BoardMateralDraw};
+bool (*KingTests[])() = {KingMovement, KingIsCheckmated, KingCastle, KingAttackersTo};
+bool (*BoardTests[])() = {BoardFirstMove, BoardPieceCollision, BoardSimplePawnPush, BoardCheckmateIterator, BoardKnightCheckmate, BoardFoolsMate, /*BoardPromotedQueen*/ BoardStalemate, BoardNotStalemate, BoardMateralDraw, BoardLegalMovesKiwipete, BoardLegalMovesPromotion, BoardPackedMoveRoundTrip, BoardMakeUnmakeKiwipete, BoardHashTransposition, BoardFENRoundTrip, BoardHalfmoveClock, BoardFiftyMoveDraw, BoardCapturesAndQuiets, BoardMoveLegality, BoardStaticExchange, BoardScoreSymmetry};
+bool (*PerftTests[])() = {PerftStartPosition, PerftKiwipete, PerftPositions, PerftSliderBackends};
+bool (*SearchTests[])() = {SearchMateInOne, SearchMateInTwo, SearchWinsMaterial, SearchQuiescence, SearchLimitsAndNoMoves, TranspositionStoreProbe, TranspositionSearch, SearchLazySMP, PawnsStructure, SearchGameRepetition};
 bool (*PerfTests[])() = {PerfSimpleGamePerf, PerfCheckmateIterator, PerfCheckmateFoolsMate};
 
 void TestIterator(bool (*UnitTest[])(), UInt64 Count, string Description = "")
@@ -706,6 +1498,7 @@ void TestIterator(bool (*UnitTest[])(), UInt64 Count, string Description = "")
 void RunAllTests()
 {
     cout << endl << "===== Starting all unit tests =====" << endl;
+    PiecesInit();
     TestIterator(PawnTests, sizeof(PawnTests)/sizeof(void*), "Pawns ");
     TestIterator(KnightTests, sizeof(KnightTests)/sizeof(void*), "Knights ");
     TestIterator(RookTests, sizeof(RookTests)/sizeof(void*), "Rooks ");
@@ -713,6 +1506,8 @@ void RunAllTests()
     TestIterator(QueenTests, sizeof(QueenTests)/sizeof(void*), "Queens ");
     TestIterator(KingTests, sizeof(KingTests)/sizeof(void*), "Kings ");
     TestIterator(BoardTests, sizeof(BoardTests)/sizeof(void*), "Board Tests ");
+    TestIterator(PerftTests, sizeof(PerftTests)/sizeof(void*), "Perft Tests ");
+    TestIterator(SearchTests, sizeof(SearchTests)/sizeof(void*), "Search Tests ");
     TestIterator(PerfTests, sizeof(PerfTests)/sizeof(void*), "Perf Tests ");
     cout << "========= Testing complete ========" << endl << endl;
 }